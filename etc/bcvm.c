@@ -0,0 +1,1166 @@
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* bcvm [ -c image ] [ -m size ] file... [ -- arg... ]
+ * run the output of rcc -target=bytecode
+ *
+ * bcvm reads the bytecode units, lays out their lit, data and bss
+ * segments in one big-endian, byte-addressed memory, resolves symbols
+ * and labels, and preloads each procedure's postfix operations into an
+ * array of instructions with their operands already decoded.  The
+ * dispatch loop is direct threaded when the host compiler has computed
+ * gotos and a switch otherwise.  -c writes the preloaded program as an
+ * image, which later runs of bcvm load in place of the text.
+ *
+ * Values live on a stack of cells; locals and arguments live in frames
+ * at the top of memory, which grow down toward the heap.  Code and host
+ * functions have addresses outside memory, so function pointers work,
+ * and imported names that no unit defines are bound to the host
+ * functions below, which take their arguments from the VM's memory.
+ * malloc allocates from the heap and free does nothing.
+ */
+
+static char rcsid[] = "$Id$";
+
+#define LOW	16		/* lowest valid data address */
+#define CODE	0x40000000UL	/* address of instruction i is CODE + i */
+#define HOST	0x7F000000UL	/* address of host function i is HOST + i */
+#define NCELLS	65536		/* size of the value stack */
+#define NFRAMES	65536		/* size of the call stack */
+#define MAGIC	"BCVM"
+
+#define OPS \
+xx(HALT)  xx(CNST)  xx(ADDRG) xx(ADDRF) xx(ADDRL) \
+xx(INDIRI1) xx(INDIRU1) xx(INDIRI2) xx(INDIRU2) xx(INDIR4) xx(INDIRF4) xx(INDIRF8) \
+xx(ASGN1) xx(ASGN2) xx(ASGN4) xx(ASGNF4) xx(ASGNF8) xx(ASGNB) \
+xx(ARG4)  xx(ARGF4) xx(ARGF8) \
+xx(CALL)  xx(CALLD) xx(RESULT) xx(ENTER) xx(RET) xx(RETV) \
+xx(JUMP)  xx(JUMPD) xx(POP) \
+xx(ADD)   xx(SUB)   xx(MUL)   xx(DIVI)  xx(DIVU)  xx(MODI)  xx(MODU) \
+xx(BAND)  xx(BOR)   xx(BXOR)  xx(LSH)   xx(RSHI)  xx(RSHU)  xx(BCOM)  xx(NEG) \
+xx(ADDF4) xx(SUBF4) xx(MULF4) xx(DIVF4) xx(NEGF4) \
+xx(ADDF8) xx(SUBF8) xx(MULF8) xx(DIVF8) xx(NEGF8) \
+xx(EQ)    xx(NE)    xx(LTI)   xx(LEI)   xx(GTI)   xx(GEI) \
+xx(LTU)   xx(LEU)   xx(GTU)   xx(GEU) \
+xx(EQF4)  xx(NEF4)  xx(LTF4)  xx(LEF4)  xx(GTF4)  xx(GEF4) \
+xx(EQF8)  xx(NEF8)  xx(LTF8)  xx(LEF8)  xx(GTF8)  xx(GEF8) \
+xx(SEXT1) xx(SEXT2) xx(ZEXT1) xx(ZEXT2) \
+xx(ITOF4) xx(ITOF8) xx(F4TOF8) xx(F8TOF4) xx(F4TOI) xx(F8TOI)
+
+enum {
+#define xx(x) x,
+OPS
+#undef xx
+NOPS };
+
+#if defined(__GNUC__) && !defined(NOTHREAD)
+#define THREADED 1
+#endif
+
+struct inst {
+	union {
+		int op;			/* opcode */
+		void *label;		/* its handler, once threaded */
+	} u;
+	int a, b;			/* operands */
+};
+
+union cell {
+	int i;
+	unsigned u;
+	float f;
+	double d;
+};
+
+struct frame {				/* a caller's registers */
+	struct inst *ip;
+	unsigned long fp, ap, ab, msp;
+};
+
+enum { CODESEG, LITSEG, DATASEG, BSSSEG, HOSTSEG, NSEGS };
+
+struct symbol {
+	char *name;
+	int file;			/* defining file, or -1 if global */
+	int seg;			/* segment, or -1 if undefined */
+	unsigned long value;		/* offset in seg */
+	int export;			/* file that exports name, or -1 */
+	struct symbol *link;
+};
+
+struct ref {				/* a use of name+addend in file */
+	char *name;
+	int file;
+	long addend;
+};
+
+struct reloc {				/* an address word in a segment */
+	int seg;
+	unsigned long offset;
+	int ref;
+};
+
+char *progname;
+static unsigned char *mem;		/* memory at addresses 0..memsize-1 */
+static unsigned long memsize = 1UL<<24;
+static unsigned long hp;		/* next free heap address */
+static unsigned long bssbase;		/* end of initialized memory */
+static struct inst *code;
+static int ncode, maxcode;
+static int entry;			/* main's first instruction */
+static int little;			/* host is little endian */
+
+static struct {				/* segments during loading */
+	unsigned char *buf;
+	unsigned long size, max;
+} segs[NSEGS];
+static unsigned long segbase[NSEGS];
+static struct symbol *buckets[1024];
+static struct ref *refs;
+static int nrefs, maxrefs;
+static struct reloc *relocs;
+static int nrelocs, maxrelocs;
+
+void *alloc(unsigned);
+static void *grow(void *, int *, int, unsigned);
+static void fault(char *, ...);
+static void loadtext(char *, int);
+static void layout(void);
+static void loadimage(FILE *, char *);
+static void writeimage(char *);
+static int run(unsigned long);
+static int findhost(char *);
+static void put32(unsigned char *, unsigned long);
+
+int main(int argc, char *argv[]) {
+	char *image = NULL, **vec;
+	unsigned long args, a;
+	int i, j, nfiles, nargs;
+	union {
+		char c;
+		int i;
+	} u;
+
+	progname = argv[0];
+	u.i = 0;
+	u.c = 1;
+	little = u.i == 1;
+	for (i = 1; i < argc && *argv[i] == '-'; i++)
+		if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+			image = argv[++i];
+		else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+			memsize = strtoul(argv[++i], NULL, 0);
+		else
+			break;
+	for (nfiles = 0; i + nfiles < argc && strcmp(argv[i+nfiles], "--") != 0; nfiles++)
+		;
+	if (nfiles == 0 || memsize < 4096 || memsize > CODE) {
+		fprintf(stderr, "usage: %s [ -c image ] [ -m size ] file... [ -- arg... ]\n", progname);
+		exit(1);
+	}
+	mem = alloc(memsize);
+	memset(mem, 0, memsize);
+	for (j = 0; j < nfiles; j++) {
+		char magic[4];
+		FILE *fp = fopen(argv[i+j], "rb");
+		if (fp == NULL) {
+			fprintf(stderr, "%s: can't read `%s'\n", progname, argv[i+j]);
+			exit(1);
+		}
+		if (fread(magic, 1, 4, fp) == 4 && memcmp(magic, MAGIC, 4) == 0) {
+			if (nfiles > 1) {
+				fprintf(stderr, "%s: `%s' is an image; it must be run alone\n",
+					progname, argv[i+j]);
+				exit(1);
+			}
+			loadimage(fp, argv[i+j]);
+		} else {
+			fclose(fp);
+			loadtext(argv[i+j], j);
+		}
+	}
+	if (bssbase == 0)
+		layout();
+	if (image) {
+		writeimage(image);
+		return 0;
+	}
+
+	/* copy the program's name and arguments to the top of memory */
+	vec = alloc((argc + 1)*sizeof *vec);
+	vec[0] = argv[i];
+	for (nargs = 1, j = i + nfiles + 1; j < argc; j++)
+		vec[nargs++] = argv[j];
+	a = memsize;
+	for (j = 0; j < nargs; j++)
+		a -= strlen(vec[j]) + 1;
+	args = (a - 8 - 4*(nargs + 1))&~7UL;
+	if (args < hp + 4096)
+		fault("arguments too long");
+	put32(&mem[args], nargs);
+	put32(&mem[args+4], args + 8);
+	for (j = 0; j < nargs; j++) {
+		put32(&mem[args + 8 + 4*j], a);
+		strcpy((char *)&mem[a], vec[j]);
+		a += strlen(vec[j]) + 1;
+	}
+	i = run(args);
+	fflush(stdout);
+	return i;
+}
+
+/* alloc - allocate n bytes or die */
+void *alloc(unsigned n) {
+	void *new = malloc(n);
+
+	if (new == NULL) {
+		fprintf(stderr, "%s: out of memory\n", progname);
+		exit(1);
+	}
+	return new;
+}
+
+/* grow - make room for n+1 elements of the given size in p, whose capacity is *max */
+static void *grow(void *p, int *max, int n, unsigned size) {
+	if (n < *max)
+		return p;
+	*max = *max ? 2 * *max : 256;
+	if ((p = realloc(p, *max*size)) == NULL) {
+		fprintf(stderr, "%s: out of memory\n", progname);
+		exit(1);
+	}
+	return p;
+}
+
+/* fault - print a run-time or load-time error and die */
+static void fault(char *fmt, ...) {
+	va_list ap;
+
+	fflush(stdout);
+	va_start(ap, fmt);
+	fprintf(stderr, "%s: ", progname);
+	vfprintf(stderr, fmt, ap);
+	fprintf(stderr, "\n");
+	va_end(ap);
+	exit(1);
+}
+
+/* strsave - return a copy of s */
+static char *strsave(char *s) {
+	return strcpy(alloc(strlen(s) + 1), s);
+}
+
+/* lookup - return the symbol for name in file, installing it if new is set */
+static struct symbol *lookup(char *name, int file, int new) {
+	unsigned h = file;
+	char *s;
+	struct symbol *p;
+
+	for (s = name; *s; s++)
+		h = (h<<1) + *(unsigned char *)s;
+	h &= sizeof buckets/sizeof buckets[0] - 1;
+	for (p = buckets[h]; p; p = p->link)
+		if (p->file == file && strcmp(p->name, name) == 0)
+			return p;
+	if (!new)
+		return NULL;
+	p = alloc(sizeof *p);
+	p->name = strsave(name);
+	p->file = file;
+	p->seg = -1;
+	p->value = 0;
+	p->export = -1;
+	p->link = buckets[h];
+	buckets[h] = p;
+	return p;
+}
+
+/* define - define name in file at the current end of seg */
+static void define(char *name, int file, int seg) {
+	struct symbol *p = lookup(name, -1, 0);
+
+	if (p == NULL || p->export != file)
+		p = lookup(name, file, 1);
+	if (p->seg >= 0)
+		fault("`%s' is defined more than once", name);
+	p->seg = seg;
+	p->value = seg == CODESEG ? (unsigned long)ncode : segs[seg].size;
+}
+
+/* number - return the integer in s, which may be an offset like 8+4 */
+static int number(char *s) {
+	unsigned long n = *s == '-' ? (unsigned long)strtol(s, &s, 10) : strtoul(s, &s, 10);
+
+	while (*s == '+' || *s == '-')
+		n += strtol(s, &s, 10);
+	return (int)n;
+}
+
+/* newref - return the index of a new reference to name[+-addend] in file */
+static int newref(char *name, int file) {
+	char *s;
+
+	refs = grow(refs, &maxrefs, nrefs, sizeof *refs);
+	refs[nrefs].addend = 0;
+	for (s = name + 1; *s; s++)
+		if (*s == '+' || *s == '-') {
+			refs[nrefs].addend = number(s);
+			*s = 0;
+			break;
+		}
+	refs[nrefs].name = strsave(name);
+	refs[nrefs].file = file;
+	return nrefs++;
+}
+
+/* emit - append instruction op a b */
+static void emit(int op, int a, int b) {
+	code = grow(code, &maxcode, ncode, sizeof *code);
+	code[ncode].u.op = op;
+	code[ncode].a = a;
+	code[ncode].b = b;
+	ncode++;
+}
+
+/* append - append the n-byte big-endian value v to seg */
+static void append(int seg, int n, unsigned long v) {
+	int max = segs[seg].max;
+
+	while (segs[seg].size + n > (unsigned long)max)
+		segs[seg].buf = grow(segs[seg].buf, &max, max, 1);
+	segs[seg].max = max;
+	while (--n >= 0)
+		segs[seg].buf[segs[seg].size++] = v>>(8*n);
+}
+
+/*
+ * opcode - return the instruction for lcc operator name with operand s, or -1
+ * if it needs none; *kind is set to 0 for no operand, 1 for a number,
+ * 2 for a symbol and 3 for a label
+ */
+static int opcode(char *name, char *s, int *kind) {
+	char base[16], type;
+	int n, size;
+
+	n = strlen(name);
+	while (n > 0 && isdigit((unsigned char)name[n-1]))
+		n--;
+	size = atoi(name + n);
+	if (n < 2 || n > (int)sizeof base)
+		return -2;
+	type = name[n-1];
+	memcpy(base, name, n - 1);
+	base[n-1] = 0;
+	*kind = 0;
+	if (strncmp(name, "CV", 2) == 0 && n == 4) {
+		int from = name[2], to = name[3], ssize = atoi(s);
+		*kind = 0;
+		if (to == 'F' && from == 'I')
+			return size == 4 ? ITOF4 : ITOF8;
+		if (to == 'F' && from == 'F')
+			return size == ssize ? -1 : size == 8 ? F4TOF8 : F8TOF4;
+		if (from == 'F')
+			return ssize == 4 ? F4TOI : F8TOI;
+		if (size == 1)
+			return to == 'I' ? SEXT1 : ZEXT1;
+		if (size == 2)
+			return to == 'I' ? SEXT2 : ZEXT2;
+		return -1;
+	}
+#define is(x) (strcmp(base, x) == 0)
+	if (is("CNST") || is("ADDRF") || is("ADDRL")) {
+		*kind = 1;
+		return is("CNST") ? CNST : is("ADDRF") ? ADDRF : ADDRL;
+	}
+	if (is("ADDRG")) {
+		*kind = 2;
+		return ADDRG;
+	}
+	if (is("INDIR")) {
+		if (type == 'B')
+			return -1;
+		if (type == 'F')
+			return size == 4 ? INDIRF4 : INDIRF8;
+		if (size == 1)
+			return type == 'I' ? INDIRI1 : INDIRU1;
+		if (size == 2)
+			return type == 'I' ? INDIRI2 : INDIRU2;
+		return INDIR4;
+	}
+	if (is("ASGN")) {
+		if (type == 'B') {
+			*kind = 1;
+			return ASGNB;
+		}
+		if (type == 'F')
+			return size == 4 ? ASGNF4 : ASGNF8;
+		return size == 1 ? ASGN1 : size == 2 ? ASGN2 : ASGN4;
+	}
+	if (is("ARG"))
+		return type != 'F' ? ARG4 : size == 4 ? ARGF4 : ARGF8;
+	if (is("CALL"))
+		return CALL;
+	if (is("RET"))
+		return type == 'V' ? RETV : RET;
+	if (is("JUMP"))
+		return JUMP;
+	if (type == 'F') {
+		static struct { char *name; int f4, f8, kind; } fops[] = {
+			{ "ADD", ADDF4, ADDF8, 0 }, { "SUB", SUBF4, SUBF8, 0 },
+			{ "MUL", MULF4, MULF8, 0 }, { "DIV", DIVF4, DIVF8, 0 },
+			{ "NEG", NEGF4, NEGF8, 0 }, { "EQ",  EQF4,  EQF8,  3 },
+			{ "NE",  NEF4,  NEF8,  3 }, { "LT",  LTF4,  LTF8,  3 },
+			{ "LE",  LEF4,  LEF8,  3 }, { "GT",  GTF4,  GTF8,  3 },
+			{ "GE",  GEF4,  GEF8,  3 }, { NULL }
+		};
+		for (n = 0; fops[n].name; n++)
+			if (is(fops[n].name)) {
+				*kind = fops[n].kind;
+				return size == 4 ? fops[n].f4 : fops[n].f8;
+			}
+		return -2;
+	}
+	if (is("ADD"))  return ADD;
+	if (is("SUB"))  return SUB;
+	if (is("MUL"))  return MUL;
+	if (is("DIV"))  return type == 'I' ? DIVI : DIVU;
+	if (is("MOD"))  return type == 'I' ? MODI : MODU;
+	if (is("BAND")) return BAND;
+	if (is("BOR"))  return BOR;
+	if (is("BXOR")) return BXOR;
+	if (is("LSH"))  return LSH;
+	if (is("RSH"))  return type == 'I' ? RSHI : RSHU;
+	if (is("BCOM")) return BCOM;
+	if (is("NEG"))  return NEG;
+	*kind = 3;
+	if (is("EQ"))   return EQ;
+	if (is("NE"))   return NE;
+	if (is("LT"))   return type == 'I' ? LTI : LTU;
+	if (is("LE"))   return type == 'I' ? LEI : LEU;
+	if (is("GT"))   return type == 'I' ? GTI : GTU;
+	if (is("GE"))   return type == 'I' ? GEI : GEU;
+#undef is
+	return -2;
+}
+
+/* loadtext - read the bytecode unit in file, the index'th one */
+static void loadtext(char *file, int index) {
+	char buf[1024], op[64], arg[512];
+	int seg = CODESEG, line = 0, label = -1, n, kind;
+	FILE *fp;
+
+	if ((fp = fopen(file, "r")) == NULL) {
+		fprintf(stderr, "%s: can't read `%s'\n", progname, file);
+		exit(1);
+	}
+	while (fgets(buf, sizeof buf, fp)) {
+		line++;
+		arg[0] = 0;
+		if (sscanf(buf, "%63s %511s", op, arg) < 1)
+			continue;
+		if (strcmp(op, "code") == 0)
+			seg = CODESEG;
+		else if (strcmp(op, "lit") == 0)
+			seg = LITSEG;
+		else if (strcmp(op, "data") == 0)
+			seg = DATASEG;
+		else if (strcmp(op, "bss") == 0)
+			seg = BSSSEG;
+		else if (strcmp(op, "export") == 0)
+			lookup(arg, -1, 1)->export = index;
+		else if (strcmp(op, "import") == 0 || strcmp(op, "file") == 0
+		|| strcmp(op, "line") == 0)
+			;
+		else if (strcmp(op, "align") == 0) {
+			if (seg != CODESEG && (n = atoi(arg)) > 0)
+				while (segs[seg].size%n)
+					append(seg, 1, 0);
+		} else if (strcmp(op, "skip") == 0)
+			for (n = atoi(arg); n > 0; n--)
+				append(seg, 1, 0);
+		else if (strcmp(op, "byte") == 0) {
+			char value[64];
+			if (sscanf(buf, "byte %d %63s", &n, value) != 2)
+				goto bad;
+			append(seg, n, *value == '-' ? (unsigned long)strtol(value, NULL, 10)
+				: strtoul(value, NULL, 10));
+		} else if (strcmp(op, "address") == 0) {
+			relocs = grow(relocs, &maxrelocs, nrelocs, sizeof *relocs);
+			relocs[nrelocs].seg = seg;
+			relocs[nrelocs].offset = segs[seg].size;
+			relocs[nrelocs++].ref = newref(arg, index);
+			append(seg, 4, 0);
+		} else if (strcmp(op, "LABELV") == 0) {
+			define(arg, index, seg);
+			if (seg == CODESEG)
+				label = ncode;
+		} else if (strcmp(op, "proc") == 0) {
+			int size, args;
+			if (sscanf(buf, "proc %*s %d %d", &size, &args) != 2)
+				goto bad;
+			define(arg, index, CODESEG);
+			emit(ENTER, (size + 7)&~7, (args + 7)&~7);
+		} else if (strcmp(op, "endproc") == 0)
+			emit(RETV, 0, 0);
+		else if (strcmp(op, "pop") == 0)
+			emit(POP, 0, 0);
+		else if ((n = opcode(op, arg, &kind)) == -2)
+			goto bad;
+		else if (n >= 0) {
+			if ((n == CALL || n == JUMP) && ncode > 0
+			&& code[ncode-1].u.op == ADDRG && label != ncode)
+				code[ncode-1].u.op = n == CALL ? CALLD : JUMPD;
+			else
+				emit(n, kind == 1 ? number(arg) : kind >= 2 ? newref(arg, index) : 0, 0);
+			if (n == CALL && strcmp(op, "CALLV") != 0)
+				emit(RESULT, 0, 0);
+		}
+		continue;
+	bad:	fprintf(stderr, "%s: %s:%d: unrecognized `%s'\n", progname, file, line, op);
+		exit(1);
+	}
+	fclose(fp);
+	for (seg = LITSEG; seg <= BSSSEG; seg++)
+		while (segs[seg].size%8)
+			append(seg, 1, 0);
+}
+
+/* resolve - return the address of reference i */
+static unsigned long resolve(int i) {
+	struct symbol *p = lookup(refs[i].name, refs[i].file, 0);
+	int k;
+
+	if (p == NULL || p->seg < 0)
+		p = lookup(refs[i].name, -1, 0);
+	if (p && p->seg >= 0)
+		return segbase[p->seg] + p->value + refs[i].addend;
+	if ((k = findhost(refs[i].name)) >= 0)
+		return HOST + k;
+	fault("undefined symbol `%s'", refs[i].name);
+	return 0;
+}
+
+/* layout - place the segments in memory and resolve references */
+static void layout(void) {
+	unsigned long a = LOW;
+	struct symbol *p;
+	int i, seg;
+
+	segbase[CODESEG] = CODE;
+	for (seg = LITSEG; seg <= BSSSEG; seg++) {
+		segbase[seg] = a;
+		if (a + segs[seg].size > memsize/2)
+			fault("program too big for %lu bytes of memory", memsize);
+		if (seg != BSSSEG)
+			memcpy(&mem[a], segs[seg].buf, segs[seg].size);
+		else
+			bssbase = a;
+		a += segs[seg].size;
+	}
+	hp = a;
+	for (i = 0; i < nrelocs; i++) {
+		unsigned long v = resolve(relocs[i].ref);
+		unsigned char *m = &mem[segbase[relocs[i].seg] + relocs[i].offset];
+		m[0] = v>>24; m[1] = v>>16; m[2] = v>>8; m[3] = v;
+	}
+	for (i = 0; i < ncode; i++)
+		switch (code[i].u.op) {
+		case ADDRG: case CALLD:
+			code[i].a = resolve(code[i].a);
+			break;
+		case JUMPD: case EQ: case NE: case LTI: case LEI: case GTI: case GEI:
+		case LTU: case LEU: case GTU: case GEU: case EQF4: case NEF4: case LTF4:
+		case LEF4: case GTF4: case GEF4: case EQF8: case NEF8: case LTF8:
+		case LEF8: case GTF8: case GEF8: {
+			unsigned long v = resolve(code[i].a);
+			if (v - CODE >= (unsigned long)ncode)
+				fault("`%s' is not a label", refs[code[i].a].name);
+			code[i].a = v - CODE;
+			break;
+			}
+		}
+	if ((p = lookup("main", -1, 0)) == NULL || p->seg != CODESEG)
+		fault("undefined symbol `main'");
+	entry = p->value;
+	emit(HALT, 0, 0);
+}
+
+/* putword - write the 4-byte big-endian word w to fp */
+static void putword(unsigned long w, FILE *fp) {
+	putc(w>>24, fp);
+	putc(w>>16, fp);
+	putc(w>>8, fp);
+	putc(w, fp);
+}
+
+/* getword - read a 4-byte big-endian word from fp */
+static unsigned long getword(FILE *fp) {
+	unsigned long w = 0;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		w = w<<8 | (getc(fp)&0xFF);
+	return w;
+}
+
+/*
+ * writeimage - write the preloaded program to file: the magic, the number
+ * of instructions, the entry, the end of initialized memory and the start
+ * of the heap, the instructions as three words each, and memory from LOW
+ */
+static void writeimage(char *file) {
+	FILE *fp = fopen(file, "wb");
+	int i;
+
+	if (fp == NULL)
+		fault("can't write `%s'", file);
+	fwrite(MAGIC, 1, 4, fp);
+	putword(ncode, fp);
+	putword(entry, fp);
+	putword(bssbase, fp);
+	putword(hp, fp);
+	for (i = 0; i < ncode; i++) {
+		putword(code[i].u.op, fp);
+		putword(code[i].a, fp);
+		putword(code[i].b, fp);
+	}
+	fwrite(&mem[LOW], 1, bssbase - LOW, fp);
+	if (fclose(fp) == EOF)
+		fault("error writing `%s'", file);
+}
+
+/* loadimage - read the image from fp, which is past its magic */
+static void loadimage(FILE *fp, char *file) {
+	int i;
+
+	ncode = getword(fp);
+	entry = getword(fp);
+	bssbase = getword(fp);
+	hp = getword(fp);
+	if (ncode <= 0 || entry >= ncode || bssbase < LOW || hp < bssbase || hp > memsize/2)
+		fault("`%s' is not a valid image", file);
+	code = alloc(ncode*sizeof *code);
+	maxcode = ncode;
+	for (i = 0; i < ncode; i++) {
+		code[i].u.op = getword(fp);
+		code[i].a = getword(fp);
+		code[i].b = getword(fp);
+		if (code[i].u.op < 0 || code[i].u.op >= NOPS)
+			fault("`%s' is not a valid image", file);
+	}
+	if (fread(&mem[LOW], 1, bssbase - LOW, fp) != bssbase - LOW)
+		fault("`%s' is truncated", file);
+	fclose(fp);
+}
+
+/* badaddress - report an access to address a */
+static unsigned char *badaddress(unsigned long a) {
+	fault("bad address 0x%lx", a);
+	return NULL;
+}
+
+#define at(a, n) ((a) >= LOW && (a) <= memsize - (n) ? &mem[a] : badaddress(a))
+
+static unsigned long get32(unsigned char *p) {
+	return (unsigned long)p[0]<<24 | (unsigned long)p[1]<<16 | p[2]<<8 | p[3];
+}
+
+static void put32(unsigned char *p, unsigned long w) {
+	p[0] = w>>24; p[1] = w>>16; p[2] = w>>8; p[3] = w;
+}
+
+static float getf(unsigned char *p) {
+	union { float f; unsigned char b[4]; } x;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		x.b[little ? 3 - i : i] = p[i];
+	return x.f;
+}
+
+static void putf(unsigned char *p, float f) {
+	union { float f; unsigned char b[4]; } x;
+	int i;
+
+	x.f = f;
+	for (i = 0; i < 4; i++)
+		p[i] = x.b[little ? 3 - i : i];
+}
+
+static double getd(unsigned char *p) {
+	union { double d; unsigned char b[8]; } x;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		x.b[little ? 7 - i : i] = p[i];
+	return x.d;
+}
+
+static void putd(unsigned char *p, double d) {
+	union { double d; unsigned char b[8]; } x;
+	int i;
+
+	x.d = d;
+	for (i = 0; i < 8; i++)
+		p[i] = x.b[little ? 7 - i : i];
+}
+
+/* host functions take the address of their arguments and set *rv */
+
+static unsigned long word(unsigned long a) {
+	return get32(at(a, 4));
+}
+
+static double dword(unsigned long a) {
+	return getd(at(a, 8));
+}
+
+/* str - return the string at address a */
+static char *str(unsigned long a) {
+	unsigned long e;
+
+	for (e = a; *at(e, 1); e++)
+		;
+	return (char *)&mem[a];
+}
+
+/* bytes - return the n bytes at address a */
+static unsigned char *bytes(unsigned long a, unsigned long n) {
+	return n == 0 ? mem : at(a, n);
+}
+
+/* format - format the printf arguments at ap into a static buffer */
+static char *format(char *fmt, unsigned long ap) {
+	static char *buf;
+	static int max;
+	char spec[64], *s;
+	int n = 0, k;
+
+	for (;;) {
+		char tmp[512];
+		int len = 1;
+		if (*fmt != '%' || fmt[1] == 0) {
+			tmp[0] = *fmt;
+			tmp[1] = 0;
+			if (*fmt == 0)
+				len = 0;
+			else
+				fmt++;
+			s = tmp;
+		} else {
+			char *t = spec, *arg = NULL;
+			int star[2], nstar = 0;
+			*t++ = *fmt++;
+			for ( ; *fmt && strchr("-+ #0123456789.*hlLqjzt", *fmt) && t < spec + 60; fmt++)
+				if (*fmt == '*') {
+					star[nstar < 2 ? nstar++ : 1] = word(ap);
+					ap += 4;
+					*t++ = '*';
+				} else if (!strchr("hlLqjzt", *fmt))
+					*t++ = *fmt;
+			*t++ = *fmt;
+			*t = 0;
+			s = tmp;
+			switch (*fmt) {
+			case 'd': case 'i': case 'c':
+				k = word(ap); ap += 4;
+				if (nstar == 2) sprintf(tmp, spec, star[0], star[1], k);
+				else if (nstar) sprintf(tmp, spec, star[0], k);
+				else sprintf(tmp, spec, k);
+				break;
+			case 'o': case 'u': case 'x': case 'X': case 'p': {
+				unsigned v = word(ap); ap += 4;
+				if (*fmt == 'p')
+					t[-1] = 'x';
+				if (nstar == 2) sprintf(tmp, spec, star[0], star[1], v);
+				else if (nstar) sprintf(tmp, spec, star[0], v);
+				else sprintf(tmp, spec, v);
+				break;
+				}
+			case 'e': case 'E': case 'f': case 'g': case 'G': {
+				double d = dword(ap); ap += 8;
+				if (nstar == 2) sprintf(tmp, spec, star[0], star[1], d);
+				else if (nstar) sprintf(tmp, spec, star[0], d);
+				else sprintf(tmp, spec, d);
+				break;
+				}
+			case 's':
+				arg = str(word(ap)); ap += 4;
+				if (nstar == 0 && strcmp(spec, "%s") == 0)
+					s = arg;
+				else if (strlen(arg) > 256)
+					fault("printf string too long");
+				else if (nstar == 2) sprintf(tmp, spec, star[0], star[1], arg);
+				else if (nstar) sprintf(tmp, spec, star[0], arg);
+				else sprintf(tmp, spec, arg);
+				break;
+			case '%':
+				strcpy(tmp, "%");
+				break;
+			default:
+				strcpy(tmp, spec);
+				break;
+			}
+			if (*fmt)
+				fmt++;
+			len = strlen(s);
+		}
+		while (n + len + 1 > max)
+			buf = grow(buf, &max, max, 1);
+		memcpy(buf + n, s, len);
+		n += len;
+		if (len == 0 && *fmt == 0)
+			break;
+	}
+	buf[n] = 0;
+	return buf;
+}
+
+static void h_printf(unsigned long ap, union cell *rv) {
+	rv->i = fputs(format(str(word(ap)), ap + 4), stdout) == EOF ? -1 : 0;
+}
+
+static void h_sprintf(unsigned long ap, union cell *rv) {
+	char *s = format(str(word(ap + 4)), ap + 8);
+
+	rv->i = strlen(s);
+	strcpy((char *)bytes(word(ap), rv->i + 1), s);
+}
+
+static void h_puts(unsigned long ap, union cell *rv) {
+	rv->i = puts(str(word(ap)));
+}
+
+static void h_putchar(unsigned long ap, union cell *rv) {
+	rv->i = putchar(word(ap));
+}
+
+static void h_getchar(unsigned long ap, union cell *rv) {
+	rv->i = getchar();
+}
+
+static void h_exit(unsigned long ap, union cell *rv) {
+	fflush(stdout);
+	exit(word(ap));
+}
+
+static void h_abort(unsigned long ap, union cell *rv) {
+	fault("abort");
+}
+
+/* h_malloc - allocate from the heap, which is never reused */
+static void h_malloc(unsigned long ap, union cell *rv) {
+	unsigned long n = (word(ap) + 7)&~7UL;
+
+	rv->u = 0;
+	if (n < memsize/2 && hp + 8 + n < memsize/2) {
+		put32(&mem[hp], n);
+		rv->u = hp + 8;
+		hp += 8 + n;
+	}
+}
+
+static void h_calloc(unsigned long ap, union cell *rv) {
+	unsigned long n = word(ap)*word(ap + 4);
+
+	put32(at(ap, 4), n);
+	h_malloc(ap, rv);
+	if (rv->u)
+		memset(&mem[rv->u], 0, n);
+}
+
+static void h_realloc(unsigned long ap, union cell *rv) {
+	unsigned long p = word(ap), n = word(ap + 4), old;
+
+	put32(at(ap, 4), n);
+	h_malloc(ap + 4, rv);
+	if (p && rv->u) {
+		old = word(p - 8);
+		memcpy(&mem[rv->u], bytes(p, old < n ? old : n), old < n ? old : n);
+	}
+}
+
+static void h_free(unsigned long ap, union cell *rv) {
+}
+
+static void h_memcpy(unsigned long ap, union cell *rv) {
+	unsigned long n = word(ap + 8);
+
+	rv->u = word(ap);
+	memmove(bytes(rv->u, n), bytes(word(ap + 4), n), n);
+}
+
+static void h_memset(unsigned long ap, union cell *rv) {
+	unsigned long n = word(ap + 8);
+
+	rv->u = word(ap);
+	memset(bytes(rv->u, n), word(ap + 4), n);
+}
+
+static void h_memcmp(unsigned long ap, union cell *rv) {
+	unsigned long n = word(ap + 8);
+
+	rv->i = memcmp(bytes(word(ap), n), bytes(word(ap + 4), n), n);
+}
+
+static void h_strlen(unsigned long ap, union cell *rv) {
+	rv->u = strlen(str(word(ap)));
+}
+
+static void h_strcpy(unsigned long ap, union cell *rv) {
+	char *s = str(word(ap + 4));
+
+	rv->u = word(ap);
+	memmove(bytes(rv->u, strlen(s) + 1), s, strlen(s) + 1);
+}
+
+static void h_strcat(unsigned long ap, union cell *rv) {
+	char *s = str(word(ap + 4));
+
+	rv->u = word(ap);
+	rv->u += strlen(str(rv->u));
+	memmove(bytes(rv->u, strlen(s) + 1), s, strlen(s) + 1);
+	rv->u = word(ap);
+}
+
+static void h_strcmp(unsigned long ap, union cell *rv) {
+	rv->i = strcmp(str(word(ap)), str(word(ap + 4)));
+}
+
+static void h_strncmp(unsigned long ap, union cell *rv) {
+	rv->i = strncmp(str(word(ap)), str(word(ap + 4)), word(ap + 8));
+}
+
+static void h_strchr(unsigned long ap, union cell *rv) {
+	unsigned long a = word(ap);
+	char *s = strchr(str(a), word(ap + 4));
+
+	rv->u = s ? a + (s - (char *)&mem[a]) : 0;
+}
+
+static void h_atoi(unsigned long ap, union cell *rv) {
+	rv->i = atoi(str(word(ap)));
+}
+
+static void h_atof(unsigned long ap, union cell *rv) {
+	rv->d = atof(str(word(ap)));
+}
+
+static void h_abs(unsigned long ap, union cell *rv) {
+	rv->i = word(ap);
+	if (rv->i < 0)
+		rv->i = -rv->i;
+}
+
+static void h_sqrt(unsigned long ap, union cell *rv)  { rv->d = sqrt(dword(ap)); }
+static void h_fabs(unsigned long ap, union cell *rv)  { rv->d = fabs(dword(ap)); }
+static void h_floor(unsigned long ap, union cell *rv) { rv->d = floor(dword(ap)); }
+static void h_exp(unsigned long ap, union cell *rv)   { rv->d = exp(dword(ap)); }
+static void h_log(unsigned long ap, union cell *rv)   { rv->d = log(dword(ap)); }
+
+static struct host {
+	char *name;
+	void (*f)(unsigned long, union cell *);
+} hosts[] = {
+	{ "printf",  h_printf },  { "sprintf", h_sprintf }, { "puts",    h_puts },
+	{ "putchar", h_putchar }, { "getchar", h_getchar }, { "exit",    h_exit },
+	{ "abort",   h_abort },   { "malloc",  h_malloc },  { "calloc",  h_calloc },
+	{ "realloc", h_realloc }, { "free",    h_free },    { "memcpy",  h_memcpy },
+	{ "memmove", h_memcpy },  { "memset",  h_memset },  { "memcmp",  h_memcmp },
+	{ "strlen",  h_strlen },  { "strcpy",  h_strcpy },  { "strcat",  h_strcat },
+	{ "strcmp",  h_strcmp },  { "strncmp", h_strncmp }, { "strchr",  h_strchr },
+	{ "atoi",    h_atoi },    { "atof",    h_atof },    { "abs",     h_abs },
+	{ "sqrt",    h_sqrt },    { "fabs",    h_fabs },    { "floor",   h_floor },
+	{ "exp",     h_exp },     { "log",     h_log },
+};
+
+/* findhost - return the index of host function name, or -1 */
+static int findhost(char *name) {
+	int i;
+
+	for (i = 0; i < (int)(sizeof hosts/sizeof hosts[0]); i++)
+		if (strcmp(hosts[i].name, name) == 0)
+			return i;
+	return -1;
+}
+
+#ifdef THREADED
+#define CASE(x)		L_##x:
+#define DISPATCH	goto *ip->u.label
+#else
+#define CASE(x)		case x:
+#define DISPATCH	continue
+#endif
+#define NEXT		ip++; DISPATCH
+
+#define BINARY(x, f, op)	CASE(x) sp[-1].f = sp[-1].f op sp[0].f; sp--; NEXT;
+#define COMPARE(x, f, op)	CASE(x) sp -= 2; \
+	if (sp[1].f op sp[2].f) { ip = code + ip->a; DISPATCH; } NEXT;
+
+/* run - run the program from main, whose arguments are at address args */
+static int run(unsigned long args) {
+	static union cell cells[NCELLS];
+	static struct frame frames[NFRAMES];
+	union cell *sp = cells - 1, rv;
+	struct frame *f = frames;
+	struct inst *ip;
+	unsigned long fp = 0, ap = args, ab = args, msp = args, argoff = 0, a;
+	unsigned char *p;
+#ifdef THREADED
+	static void *labels[] = {
+#define xx(x) &&L_##x,
+	OPS
+#undef xx
+	};
+	int i;
+
+	for (i = 0; i < ncode; i++)
+		code[i].u.label = labels[code[i].u.op];
+#endif
+
+	rv.i = 0;
+	f->ip = &code[ncode-1];		/* main returns to HALT */
+	f++;
+	ip = &code[entry];
+#ifdef THREADED
+	DISPATCH;
+#else
+	for (;;)
+		switch (ip->u.op) {
+#endif
+	CASE(HALT)	return rv.i;
+	CASE(CNST)	(++sp)->i = ip->a; NEXT;
+	CASE(ADDRG)	(++sp)->u = ip->a; NEXT;
+	CASE(ADDRF)	(++sp)->u = ap + ip->a; NEXT;
+	CASE(ADDRL)	(++sp)->u = fp + ip->a; NEXT;
+	CASE(INDIRI1)	p = at(sp->u, 1); sp->i = (p[0]^0x80) - 0x80; NEXT;
+	CASE(INDIRU1)	p = at(sp->u, 1); sp->u = p[0]; NEXT;
+	CASE(INDIRI2)	p = at(sp->u, 2); sp->i = ((p[0]<<8 | p[1])^0x8000) - 0x8000; NEXT;
+	CASE(INDIRU2)	p = at(sp->u, 2); sp->u = p[0]<<8 | p[1]; NEXT;
+	CASE(INDIR4)	p = at(sp->u, 4); sp->u = get32(p); NEXT;
+	CASE(INDIRF4)	p = at(sp->u, 4); sp->f = getf(p); NEXT;
+	CASE(INDIRF8)	p = at(sp->u, 8); sp->d = getd(p); NEXT;
+	CASE(ASGN1)	p = at(sp[-1].u, 1); p[0] = sp[0].u; sp -= 2; NEXT;
+	CASE(ASGN2)	p = at(sp[-1].u, 2); p[0] = sp[0].u>>8; p[1] = sp[0].u; sp -= 2; NEXT;
+	CASE(ASGN4)	p = at(sp[-1].u, 4); put32(p, sp[0].u); sp -= 2; NEXT;
+	CASE(ASGNF4)	p = at(sp[-1].u, 4); putf(p, sp[0].f); sp -= 2; NEXT;
+	CASE(ASGNF8)	p = at(sp[-1].u, 8); putd(p, sp[0].d); sp -= 2; NEXT;
+	CASE(ASGNB)	p = at(sp[-1].u, ip->a);
+			memmove(p, at(sp[0].u, ip->a), ip->a); sp -= 2; NEXT;
+	CASE(ARG4)	p = at(ab + argoff, 4); put32(p, sp->u); sp--; argoff += 4; NEXT;
+	CASE(ARGF4)	p = at(ab + argoff, 4); putf(p, sp->f); sp--; argoff += 4; NEXT;
+	CASE(ARGF8)	p = at(ab + argoff, 8); putd(p, sp->d); sp--; argoff += 8; NEXT;
+	CASE(CALL)	a = (sp--)->u; goto call;
+	CASE(CALLD)	a = (unsigned)ip->a;
+	call:		argoff = 0;
+			if (a - CODE < (unsigned long)ncode) {
+				if (f == &frames[NFRAMES])
+					fault("call stack overflow");
+				f->ip = ip + 1;
+				f->fp = fp;
+				f->ap = ap;
+				f->ab = ab;
+				f->msp = msp;
+				f++;
+				ap = ab;
+				ip = &code[a - CODE];
+				DISPATCH;
+			}
+			if (a - HOST >= sizeof hosts/sizeof hosts[0])
+				fault("call to bad address 0x%lx", a);
+			(*hosts[a - HOST].f)(ab, &rv);
+			NEXT;
+	CASE(RESULT)	*++sp = rv; NEXT;
+	CASE(ENTER)	msp -= ip->a + ip->b;
+			if (msp < hp + 256 || sp >= &cells[NCELLS-256])
+				fault("stack overflow");
+			fp = msp;
+			ab = msp + ip->a;
+			NEXT;
+	CASE(RET)	rv = *sp--;
+	CASE(RETV)	f--;
+			ip = f->ip;
+			fp = f->fp;
+			ap = f->ap;
+			ab = f->ab;
+			msp = f->msp;
+			DISPATCH;
+	CASE(JUMP)	a = (sp--)->u;
+			if (a - CODE >= (unsigned long)ncode)
+				fault("jump to bad address 0x%lx", a);
+			ip = &code[a - CODE];
+			DISPATCH;
+	CASE(JUMPD)	ip = &code[ip->a]; DISPATCH;
+	CASE(POP)	sp--; NEXT;
+	BINARY(ADD, u, +)
+	BINARY(SUB, u, -)
+	BINARY(MUL, u, *)
+	CASE(DIVI)	if (sp[0].i == 0) fault("division by zero");
+			sp[-1].i /= sp[0].i; sp--; NEXT;
+	CASE(DIVU)	if (sp[0].u == 0) fault("division by zero");
+			sp[-1].u /= sp[0].u; sp--; NEXT;
+	CASE(MODI)	if (sp[0].i == 0) fault("division by zero");
+			sp[-1].i %= sp[0].i; sp--; NEXT;
+	CASE(MODU)	if (sp[0].u == 0) fault("division by zero");
+			sp[-1].u %= sp[0].u; sp--; NEXT;
+	BINARY(BAND, u, &)
+	BINARY(BOR, u, |)
+	BINARY(BXOR, u, ^)
+	CASE(LSH)	sp[-1].u <<= sp[0].u&31; sp--; NEXT;
+	CASE(RSHI)	sp[-1].i >>= sp[0].u&31; sp--; NEXT;
+	CASE(RSHU)	sp[-1].u >>= sp[0].u&31; sp--; NEXT;
+	CASE(BCOM)	sp->u = ~sp->u; NEXT;
+	CASE(NEG)	sp->u = -sp->u; NEXT;
+	BINARY(ADDF4, f, +)
+	BINARY(SUBF4, f, -)
+	BINARY(MULF4, f, *)
+	BINARY(DIVF4, f, /)
+	CASE(NEGF4)	sp->f = -sp->f; NEXT;
+	BINARY(ADDF8, d, +)
+	BINARY(SUBF8, d, -)
+	BINARY(MULF8, d, *)
+	BINARY(DIVF8, d, /)
+	CASE(NEGF8)	sp->d = -sp->d; NEXT;
+	COMPARE(EQ, u, ==)
+	COMPARE(NE, u, !=)
+	COMPARE(LTI, i, <)
+	COMPARE(LEI, i, <=)
+	COMPARE(GTI, i, >)
+	COMPARE(GEI, i, >=)
+	COMPARE(LTU, u, <)
+	COMPARE(LEU, u, <=)
+	COMPARE(GTU, u, >)
+	COMPARE(GEU, u, >=)
+	COMPARE(EQF4, f, ==)
+	COMPARE(NEF4, f, !=)
+	COMPARE(LTF4, f, <)
+	COMPARE(LEF4, f, <=)
+	COMPARE(GTF4, f, >)
+	COMPARE(GEF4, f, >=)
+	COMPARE(EQF8, d, ==)
+	COMPARE(NEF8, d, !=)
+	COMPARE(LTF8, d, <)
+	COMPARE(LEF8, d, <=)
+	COMPARE(GTF8, d, >)
+	COMPARE(GEF8, d, >=)
+	CASE(SEXT1)	sp->i = ((sp->u&0xFF)^0x80) - 0x80; NEXT;
+	CASE(SEXT2)	sp->i = ((sp->u&0xFFFF)^0x8000) - 0x8000; NEXT;
+	CASE(ZEXT1)	sp->u &= 0xFF; NEXT;
+	CASE(ZEXT2)	sp->u &= 0xFFFF; NEXT;
+	CASE(ITOF4)	sp->f = (float)sp->i; NEXT;
+	CASE(ITOF8)	{ int x = sp->i; sp->d = x; } NEXT;
+	CASE(F4TOF8)	{ float x = sp->f; sp->d = x; } NEXT;
+	CASE(F8TOF4)	{ double x = sp->d; sp->f = (float)x; } NEXT;
+	CASE(F4TOI)	sp->i = (int)sp->f; NEXT;
+	CASE(F8TOI)	sp->i = (int)sp->d; NEXT;
+#ifndef THREADED
+		default:
+			fault("bad instruction %d", ip->u.op);
+		}
+#endif
+	return 0;
+}
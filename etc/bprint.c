@@ -5,7 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 
-/* bprint [ -c | -Idir... | -f | -b | -n ] [ file... ]
+/* bprint [ -c | -C | -Idir... | -f | -b | -n ] [ file... ]
  * annotate listings of files with prof.out data
  */
 
@@ -20,7 +20,7 @@ char *dirs[20];
 int fcount;
 
 void *alloc(unsigned);
-void emitdata(char *);
+void emitdata(char *, int);
 void printfile(struct file *, int);
 void printfuncs(struct file *, int);
 
@@ -43,7 +43,10 @@ int main(int argc, char *argv[]) {
 	}
 	for (i = 1; i < argc && *argv[i] == '-'; i++)
 		if (strcmp(argv[i], "-c") == 0) {
-			emitdata("prof.out"); 
+			emitdata("prof.out", 0); 
+			exit(0);
+		} else if (strcmp(argv[i], "-C") == 0) {
+			emitdata("prof.out", 1);
 			exit(0);
 		} else if (strcmp(argv[i], "-b") == 0)
 			f = printfile;
@@ -61,7 +64,7 @@ int main(int argc, char *argv[]) {
 			else
 				fprintf(stderr, "%s: too many -I options\n", progname);
 		} else {
-			fprintf(stderr, "usage: %s [ -c | -b | -n | -f | -Idir... ] [ file... ]\n", progname);
+			fprintf(stderr, "usage: %s [ -c | -C | -b | -n | -f | -Idir... ] [ file... ]\n", progname);
 			exit(1);
 		}
 	for (p = filelist; p; p = p->link)
@@ -89,34 +92,87 @@ void *alloc(unsigned n) {
 	return new;
 }
 
-/* emitdata - write prof.out data to file */
-void emitdata(char *file) {
+/* putd - write n to fp, in binary if compact */
+static void putd(FILE *fp, int n, int compact) {
+	if (compact) {
+		putc(n&0xff, fp);
+		putc((n>>8)&0xff, fp);
+		putc((n>>16)&0xff, fp);
+		putc((n>>24)&0xff, fp);
+	} else
+		fprintf(fp, "%d", n);
+}
+
+/* putstr - write s to fp, zero-terminated if compact */
+static void putstr(FILE *fp, char *s, int compact) {
+	fputs(s, fp);
+	if (compact)
+		putc(0, fp);
+}
+
+/* putsep - write separator c to fp unless compact */
+static void putsep(FILE *fp, int c, int compact) {
+	if (!compact)
+		putc(c, fp);
+}
+
+/* emitdata - write prof.out data to file, in the compact form if compact */
+void emitdata(char *file, int compact) {
 	FILE *fp;
 
-	if (fp = fopen(file, "w")) {
+	if (fp = fopen(file, compact ? "wb" : "w")) {
 		struct file *p;
+		if (compact)
+			fputs("PROF", fp);
 		for (p = filelist; p; p = p->link) {
 			int i;
 			struct func *q;
 			struct caller *r;
-			fprintf(fp, "1\n%s\n", p->name);
+			putd(fp, 1, compact);
+			putsep(fp, '\n', compact);
+			putstr(fp, p->name, compact);
+			putsep(fp, '\n', compact);
 			for (i = 0, q = p->funcs; q; i++, q = q->link)
 				if (r = q->callers)
 					for (i--; r; r = r->link)
 						i++;
-			fprintf(fp, "%d\n", i);
-			for (q = p->funcs; q; q = q->link)
-				if (q->count.count == 0 || !q->callers)
-					fprintf(fp, "%s 1 %d %d %d ? ? 0 0\n", q->name, q->count.x,
-						q->count.y, q->count.count);
-				else
-					for (r = q->callers; r; r = r->link)
-						fprintf(fp, "%s 1 %d %d %d %s %s %d %d\n", q->name, q->count.x,
-							q->count.y, r->count, r->name, r->file, r->x, r->y);
-			fprintf(fp, "%d\n", p->count);
-			for (i = 0; i < p->count; i++)
-				fprintf(fp, "1 %d %d %d\n", p->counts[i].x,
-					p->counts[i].y, p->counts[i].count);
+			putd(fp, i, compact);
+			putsep(fp, '\n', compact);
+			for (q = p->funcs; q; q = q->link) {
+				r = q->count.count == 0 ? 0 : q->callers;
+				do {
+					putstr(fp, q->name, compact);
+					putsep(fp, ' ', compact);
+					putd(fp, 1, compact);
+					putsep(fp, ' ', compact);
+					putd(fp, q->count.x, compact);
+					putsep(fp, ' ', compact);
+					putd(fp, q->count.y, compact);
+					putsep(fp, ' ', compact);
+					putd(fp, r ? r->count : q->count.count, compact);
+					putsep(fp, ' ', compact);
+					putstr(fp, r ? r->name : "?", compact);
+					putsep(fp, ' ', compact);
+					putstr(fp, r ? r->file : "?", compact);
+					putsep(fp, ' ', compact);
+					putd(fp, r ? r->x : 0, compact);
+					putsep(fp, ' ', compact);
+					putd(fp, r ? r->y : 0, compact);
+					putsep(fp, '\n', compact);
+				} while (r && (r = r->link));
+			}
+			putd(fp, p->count, compact);
+			putsep(fp, '\n', compact);
+			for (i = 0; i < p->count; i++) {
+				putd(fp, 1, compact);
+				putsep(fp, ' ', compact);
+				putd(fp, p->counts[i].x, compact);
+				putsep(fp, ' ', compact);
+				putd(fp, p->counts[i].y, compact);
+				putsep(fp, ' ', compact);
+				putd(fp, p->counts[i].count, compact);
+				putsep(fp, '\n', compact);
+			}
 		}
 		fclose(fp);
 	} else
@@ -200,15 +256,20 @@ void printfuncs(struct file *p, int nf) {
 
 /* string - save a copy of str, if necessary */
 char *string(const char *str) {
-	static struct string { struct string *link; char str[1]; } *list;
+	static struct string { struct string *link; char str[1]; } *buckets[1024];
 	struct string *p;
+	const char *s;
+	unsigned h;
 
-	for (p = list; p; p = p->link)
+	for (h = 0, s = str; *s; s++)
+		h = (h<<1) + *s;
+	h &= NELEMS(buckets) - 1;
+	for (p = buckets[h]; p; p = p->link)
 		if (strcmp(p->str, str) == 0)
 			return p->str;
 	p = alloc(strlen(str) + sizeof *p);
 	strcpy(p->str, str);
-	p->link = list;
-	list = p;
+	p->link = buckets[h];
+	buckets[h] = p;
 	return p->str;
 }
@@ -493,6 +493,7 @@ static void help(void) {
 "-static	specify static libraries (default is dynamic)\n",
 "-dynamic	specify dynamically linked libraries\n",
 "-t -tname	emit function tracing calls to printf or to `name'\n",
+"-tring=N	trace function calls into an N-record ring buffer\n",
 "-target name	is ignored\n",
 "-tempdir=dir	place temporary files in `dir/'", "\n"
 "-Uname	undefine the preprocessor symbol `name'\n",
@@ -606,7 +607,7 @@ xx(unsigned_int,4)
 			clist = append(arg, clist);
 		}
 		return;
-	case 't':	/* -t -tname -tempdir=dir */
+	case 't':	/* -t -tname -tring=N -tempdir=dir */
 		if (strncmp(arg, "-tempdir=", 9) == 0)
 			tempdir = arg + 9;
 		else
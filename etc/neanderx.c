@@ -58,23 +58,24 @@ char *com[] = {
 /*
  * Assembler - NEANDER-X doesn't have a standard assembler yet.
  * This placeholder can be replaced with a custom assembler path.
- * For now, we just copy the assembly output.
+ * For now, the "object" file is a copy of the assembly output,
+ * which the linker below reads.
  */
 char *as[] = {
-    "/bin/cat",  /* Placeholder - just output the assembly */
-    "$1", "$2",
+    "/bin/cp",  /* Placeholder - just copy the assembly */
+    "$2", "$3",
     0
 };
 
 /*
- * Linker - NEANDER-X doesn't have a standard linker.
- * The output is typically a raw binary or hex file for simulation.
- * This is a placeholder that can be customized.
+ * Linker - nxld merges the assembly files into one program,
+ * resolving .global/.extern names and dropping functions and
+ * data that are unreachable from _start.  -Wl-M prints a size map.
  */
 char *ld[] = {
-    "/bin/cat",  /* Placeholder - just concatenate files */
-    "$1", "$2",
+    LCCDIR "nxld",
     "-o", "$3",
+    "$1", "$2",
     0
 };
 
@@ -87,9 +88,13 @@ int option(char *arg) {
         include[0] = concat("-I", concat(&arg[8], "/include"));
         include[1] = concat("-I", concat(&arg[8], "/neanderx/include"));
         com[0] = concat(&arg[8], "/rcc");
+        ld[0] = concat(&arg[8], "/nxld");
     } else if (strcmp(arg, "-S") == 0) {
         /* Generate assembly only (default for NEANDER-X) */
         ;
+    } else if (strcmp(arg, "-b") == 0) {
+        /* Profiling - counters stay in memory; nxprof reads a dump */
+        ;
     } else if (strcmp(arg, "-g") == 0) {
         /* Debug info - add comment-style debug */
         ;
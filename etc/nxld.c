@@ -0,0 +1,798 @@
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* nxld [ -o file ] [ -M ] [ -S ] [ -e symbol ]... file...
+ * link NEANDER-X assembly files produced by rcc -target=neanderx
+ *
+ * There is no NEANDER-X object format; the "objects" are the assembly
+ * files themselves, and the output is one assembly file for the
+ * assembler.  nxld keeps the runtime header (variables, startup code)
+ * of the first file only, gives each file's non-.global labels unique
+ * names, merges the .text, .data, .rodata and .bss sections of all
+ * files and the .org blocks (e.g. -hotdata) that share an address, and
+ * drops every function and data item that cannot be reached from
+ * _start.  The section boundaries the startup code uses, __bss_start
+ * and the like, are left to the assembler; nxld pads .data and .bss to
+ * an even size, since that code moves them a word at a time.  -M
+ * prints a map of what was kept and removed, with sizes estimated from
+ * a one-byte opcode plus a two-byte operand.
+ *
+ * rcc notes each function's frame and outgoing argument bytes in a
+ * "; Stack:" comment; nxld combines them with the calls in the kept
+ * code to find the deepest stack _start can reach, warns when it does
+ * not fit between the runtime data and 0xFF, and with -S lists the
+ * depth of every function.
+ *
+ * The "; line" table rcc -lines appends to a file is carried over with
+ * the labels renamed; entries for removed code are dropped.
+ */
+
+static char rcsid[] = "$Id$";
+
+#define NELEMS(a) ((int)(sizeof (a)/sizeof ((a)[0])))
+
+enum { TEXT, DATA, RODATA, BSS, ORG, NSECTS };
+enum { CALLED = 1, JUMPED = 2 };
+#define STACKBASE 0x0030	/* lowest possible stack address */
+#define STACKTOP  0x00FF	/* initial SP */
+static char *sectname[] = { ".text", ".data", ".rodata", ".bss", ".org" };
+static char *layoutsyms[] = {	/* defined by the assembler */
+	"__data_start", "__data_end", "__data_load", "__bss_start", "__bss_end"
+};
+
+struct line {			/* a line of assembly */
+	char *text;
+	struct line *link;
+};
+
+struct obj {			/* a function or data item */
+	char *name;		/* its first label, or NULL */
+	int file;		/* index in files[] */
+	int sect, org;		/* section; address for ORG */
+	int size;		/* estimated bytes */
+	int live;
+	int addr;
+	int frame, args;	/* stack bytes, from rcc's "; Stack:" comment */
+	int depth;		/* deepest stack from here, or -1 */
+	int visiting;		/* on the current call path */
+	int indirect;		/* calls through _icall */
+	struct obj *deepest;	/* callee on the deepest path */
+	struct line *lines, **tail;
+	struct ref *refs;
+	struct obj *link;
+};
+
+struct ref {			/* a symbol used by an object */
+	struct sym *sym;
+	int kind;		/* CALLED and/or JUMPED */
+	struct ref *link;
+};
+
+struct sym {			/* a label, after renaming */
+	char *name;
+	struct obj *def;	/* the object defining it */
+	int file;		/* defining file, or -1 for .global/header */
+	int used;		/* referenced at all */
+	struct sym *link;
+};
+
+struct lineent {		/* an entry in a -lines table */
+	struct sym *sym;	/* its _LN label */
+	char *coord;		/* file:line */
+	struct lineent *link;
+};
+
+struct file {
+	char *name;
+	char **lines;
+	int nlines;
+	int header;		/* lines in the runtime header */
+	char **locals;		/* its non-.global labels ... */
+	char **renamed;		/* ... and their names in the output */
+	int nlocals;
+	char **globals;		/* names it declares .global */
+	int nglobals;
+};
+
+char *progname;
+static struct file *files;
+static int nfiles;
+static struct sym *symtab[1024];
+static struct obj *objs, **objtail = &objs;
+static struct obj *header;
+static struct lineent *lines, **linetail = &lines;
+static int errors;
+
+void *alloc(unsigned);
+char *string(const char *, int);
+static void readfile(int, char *);
+static void scanlabels(struct file *);
+static void splitfile(int);
+static struct sym *lookup(char *);
+static int layoutsym(char *);
+static void mark(struct obj *);
+static void emit(FILE *);
+static void printmap(FILE *);
+static int depth(struct obj *);
+static void checkstack(FILE *);
+
+int main(int argc, char *argv[]) {
+	char *outfile = NULL, *entries[16];
+	int i, j, k, nentries = 0, map = 0, stack = 0;
+	FILE *out = stdout;
+
+	progname = argv[0];
+	for (i = 1; i < argc && *argv[i] == '-'; i++)
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			outfile = argv[++i];
+		else if (strcmp(argv[i], "-M") == 0)
+			map++;
+		else if (strcmp(argv[i], "-S") == 0)
+			stack++;
+		else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc
+		&& nentries < NELEMS(entries))
+			entries[nentries++] = argv[++i];
+		else {
+			fprintf(stderr, "usage: %s [ -o file ] [ -M ] [ -S ] [ -e symbol ]... file...\n", progname);
+			exit(1);
+		}
+	if (i == argc) {
+		fprintf(stderr, "%s: no input files\n", progname);
+		exit(1);
+	}
+	nfiles = argc - i;
+	files = alloc(nfiles*sizeof *files);
+	for (j = 0; j < nfiles; j++)
+		readfile(j, argv[i+j]);
+	for (j = 0; j < nfiles; j++)
+		scanlabels(&files[j]);
+	/* a label local to several files gets a file suffix everywhere but the first */
+	for (j = 0; j < nfiles; j++)
+		for (k = 0; k < files[j].nlocals; k++) {
+			char *name = files[j].locals[k];
+			int f, n;
+			for (f = 0; f < j; f++) {
+				for (n = 0; n < files[f].nlocals && files[f].locals[n] != name; n++)
+					;
+				if (n < files[f].nlocals)
+					break;
+			}
+			if (f < j || lookup(name)->file == -1) {
+				char buf[512];
+				sprintf(buf, "%.480s.%d", name, j + 1);
+				files[j].renamed[k] = string(buf, strlen(buf));
+			}
+		}
+	for (j = 0; j < nfiles; j++)
+		splitfile(j);
+	if (header)
+		mark(header);
+	for (j = 0; j < nentries; j++) {
+		struct sym *p = lookup(string(entries[j], strlen(entries[j])));
+		if (p->def)
+			mark(p->def);
+		else
+			fprintf(stderr, "%s: entry `%s' is not defined\n", progname, entries[j]);
+	}
+	if (header == NULL && nentries == 0) {
+		struct sym *p = lookup(string("_start", 6));
+		if (p->def == NULL)
+			p = lookup(string("_main", 5));
+		if (p->def)
+			mark(p->def);
+	}
+	for (i = 0; i < NELEMS(symtab); i++) {
+		struct sym *p;
+		for (p = symtab[i]; p; p = p->link)
+			if (p->used && p->def == NULL && !layoutsym(p->name)) {
+				fprintf(stderr, "%s: undefined symbol `%s'\n", progname, p->name);
+				errors++;
+			}
+	}
+	if (errors)
+		exit(1);
+	if (outfile && (out = fopen(outfile, "w")) == NULL) {
+		fprintf(stderr, "%s: can't write `%s'\n", progname, outfile);
+		exit(1);
+	}
+	emit(out);
+	if (map)
+		printmap(out == stdout ? stderr : stdout);
+	if (header)
+		checkstack(stack ? out == stdout ? stderr : stdout : NULL);
+	if (out != stdout && fclose(out) == EOF) {
+		fprintf(stderr, "%s: error writing `%s'\n", progname, outfile);
+		exit(1);
+	}
+	return errors ? 1 : 0;
+}
+
+/* alloc - allocate n bytes or die */
+void *alloc(unsigned n) {
+	void *new = malloc(n);
+
+	assert(new);
+	if (new == NULL) {
+		fprintf(stderr, "%s: out of memory\n", progname);
+		exit(1);
+	}
+	return new;
+}
+
+/* string - save a copy of str[0..len-1], returning the same pointer for equal strings */
+char *string(const char *str, int len) {
+	static struct string { char *str; int len; struct string *link; } *buckets[1024];
+	struct string *p;
+	unsigned h = 0;
+	int i;
+
+	for (i = 0; i < len; i++)
+		h = (h<<1) + str[i];
+	h &= NELEMS(buckets) - 1;
+	for (p = buckets[h]; p; p = p->link)
+		if (p->len == len && strncmp(p->str, str, len) == 0)
+			return p->str;
+	p = alloc(sizeof *p);
+	p->str = alloc(len + 1);
+	strncpy(p->str, str, len);
+	p->str[len] = 0;
+	p->len = len;
+	p->link = buckets[h];
+	buckets[h] = p;
+	return p->str;
+}
+
+/* lookup - the symbol named name, installing it if necessary */
+static struct sym *lookup(char *name) {
+	unsigned h = ((unsigned long)name >> 3) & (NELEMS(symtab) - 1);
+	struct sym *p;
+
+	for (p = symtab[h]; p; p = p->link)
+		if (p->name == name)
+			return p;
+	p = alloc(sizeof *p);
+	p->name = name;
+	p->def = NULL;
+	p->file = 0;
+	p->used = 0;
+	p->link = symtab[h];
+	symtab[h] = p;
+	return p;
+}
+
+/* layoutsym - is name one of the section boundaries the assembler defines? */
+static int layoutsym(char *name) {
+	int i;
+
+	for (i = 0; i < NELEMS(layoutsyms); i++)
+		if (strcmp(name, layoutsyms[i]) == 0)
+			return 1;
+	return 0;
+}
+
+/* readfile - read file name into files[i], finding its runtime header */
+static void readfile(int i, char *name) {
+	struct file *f = &files[i];
+	char buf[1024];
+	int n = 0, max = 256, start = -1;
+	FILE *fp;
+
+	if ((fp = fopen(name, "r")) == NULL) {
+		fprintf(stderr, "%s: can't read `%s'\n", progname, name);
+		exit(1);
+	}
+	f->name = name;
+	f->lines = alloc(max*sizeof *f->lines);
+	while (fgets(buf, sizeof buf, fp)) {
+		int len = strlen(buf);
+		while (len > 0 && (buf[len-1] == '\n' || buf[len-1] == '\r'))
+			len--;
+		if (n == max) {
+			char **lines = alloc(2*max*sizeof *lines);
+			memcpy(lines, f->lines, max*sizeof *lines);
+			free(f->lines);
+			f->lines = lines;
+			max *= 2;
+		}
+		f->lines[n++] = string(buf, len);
+	}
+	fclose(fp);
+	f->nlines = n;
+	/* the header ends with the HLT after the startup code's CALL _main */
+	f->header = 0;
+	for (i = 0; i < n; i++)
+		if (strcmp(f->lines[i], "_start:") == 0)
+			start = i;
+		else if (start >= 0 && strcmp(f->lines[i], "    HLT") == 0) {
+			f->header = i + 1;
+			break;
+		}
+}
+
+/* labelof - the label defined by line s, or NULL */
+static char *labelof(char *s) {
+	char *t = s;
+
+	if (!(isalpha((unsigned char)*t) || *t == '_' || *t == '.' || *t == '$'))
+		return NULL;
+	while (isalnum((unsigned char)*t) || *t == '_' || *t == '.' || *t == '$')
+		t++;
+	return *t == ':' ? string(s, t - s) : NULL;
+}
+
+/* directive - the directive or mnemonic of line s, without its label, in buf */
+static char *directive(char *s, char *buf, int size) {
+	char *t;
+	int n;
+
+	if (labelof(s))
+		s = strchr(s, ':') + 1;
+	while (*s == ' ' || *s == '\t')
+		s++;
+	for (t = s; *t && *t != ' ' && *t != '\t' && *t != ';'; t++)
+		;
+	n = t - s < size - 1 ? t - s : size - 1;
+	strncpy(buf, s, n);
+	buf[n] = 0;
+	return t;
+}
+
+/* scanlabels - note f's labels, .global names and the header's labels */
+static void scanlabels(struct file *f) {
+	char *name, op[32];
+	int i, k, max = f->nlines + 1;
+
+	f->locals = alloc(max*sizeof *f->locals);
+	f->renamed = alloc(max*sizeof *f->renamed);
+	f->globals = alloc(max*sizeof *f->globals);
+	f->nlocals = f->nglobals = 0;
+	for (i = 0; i < f->nlines; i++) {
+		char *rest = directive(f->lines[i], op, sizeof op);
+		if (strcmp(op, ".global") == 0) {
+			while (*rest == ' ' || *rest == '\t')
+				rest++;
+			for (k = 0; rest[k] && !isspace((unsigned char)rest[k]) && rest[k] != ';'; k++)
+				;
+			f->globals[f->nglobals++] = string(rest, k);
+			lookup(f->globals[f->nglobals-1])->file = -1;
+		}
+	}
+	for (i = 0; i < f->nlines; i++)
+		if ((name = labelof(f->lines[i])) != NULL) {
+			if (i < f->header) {
+				lookup(name)->file = -1;
+				continue;
+			}
+			for (k = 0; k < f->nglobals && f->globals[k] != name; k++)
+				;
+			if (k == f->nglobals) {
+				f->renamed[f->nlocals] = name;
+				f->locals[f->nlocals++] = name;
+			}
+		}
+}
+
+/* newname - name's name in the output of file f */
+static char *newname(struct file *f, char *name) {
+	int k;
+
+	for (k = 0; k < f->nlocals; k++)
+		if (f->locals[k] == name)
+			return f->renamed[k];
+	return name;
+}
+
+/* size - estimated bytes assembled from line s */
+static int size(char *s) {
+	char op[32], *t = directive(s, op, sizeof op);
+	int n;
+
+	if (op[0] == 0)
+		return 0;
+	if (strcmp(op, ".space") == 0)
+		return atoi(t);
+	if (strcmp(op, ".byte") == 0 || strcmp(op, ".word") == 0 || strcmp(op, ".long") == 0) {
+		for (n = 1; *t && *t != ';'; t++)
+			if (*t == ',')
+				n++;
+		return n*(op[1] == 'b' ? 1 : op[1] == 'w' ? 2 : 4);
+	}
+	if (strcmp(op, ".ascii") == 0 || strcmp(op, ".asciz") == 0) {
+		n = op[5] == 'z';
+		if ((t = strchr(t, '"')) != NULL) {
+			for (t++; *t && *t != '"'; t++, n++)
+				if (*t == '\\' && isdigit((unsigned char)t[1]))
+					t += 3;
+				else if (*t == '\\')
+					t++;
+		}
+		return n;
+	}
+	if (op[0] == '.')
+		return 0;
+	/* an instruction: opcode, and a 16-bit operand if it has one */
+	while (*t == ' ' || *t == '\t')
+		t++;
+	return *t && *t != ';' ? 3 : 1;
+}
+
+/* generated - is name a label made up by rcc (_L123, or _LN123 for -lines)? */
+static int generated(char *name) {
+	if (strncmp(name, "_LN", 3) == 0)
+		name += 3;
+	else if (strncmp(name, "_L", 2) == 0)
+		name += 2;
+	else
+		return 0;
+	if (!isdigit((unsigned char)*name))
+		return 0;
+	for ( ; isdigit((unsigned char)*name); name++)
+		;
+	return *name == 0;
+}
+
+/* newobj - start a new object in section sect of file i */
+static struct obj *newobj(char *name, int i, int sect, int org) {
+	struct obj *p = alloc(sizeof *p);
+
+	p->name = name;
+	p->file = i;
+	p->sect = sect;
+	p->org = org;
+	p->size = p->live = p->addr = 0;
+	p->lines = NULL;
+	p->tail = &p->lines;
+	p->refs = NULL;
+	p->frame = p->args = p->visiting = p->indirect = 0;
+	p->depth = -1;
+	p->deepest = NULL;
+	p->link = NULL;
+	*objtail = p;
+	objtail = &p->link;
+	return p;
+}
+
+/* addline - append text to p, noting the symbols it uses */
+static void addline(struct obj *p, struct file *f, char *text) {
+	char buf[1024], op[32], *s, *t, *b = buf;
+	struct line *lp = alloc(sizeof *lp);
+	struct ref *r;
+	int kind = 0;
+
+	/* rewrite the labels, leaving comments and strings alone */
+	s = text;
+	if (labelof(text)) {
+		sprintf(buf, "%s:", newname(f, labelof(text)));
+		b = buf + strlen(buf);
+		s = strchr(text, ':') + 1;
+	}
+	t = directive(text, op, sizeof op);
+	memcpy(b, s, t - s);
+	b += t - s;
+	s = t;
+	if ((t = strstr(s, "; Stack:")) != NULL)
+		sscanf(t, "; Stack: %d bytes frame, %d bytes arguments", &p->frame, &p->args);
+	if (strcmp(op, "CALL") == 0)
+		kind = CALLED;
+	else if (op[0] == 'J')
+		kind = JUMPED;
+	while (*s && *s != ';' && op[0] != 0 && strncmp(op, ".asci", 5) != 0
+	&& b < buf + sizeof buf - 512)
+		if (isalpha((unsigned char)*s) || *s == '_' || *s == '$'
+		|| (*s == '.' && b > buf && !isalnum((unsigned char)b[-1]))) {
+			char *name;
+			for (t = s; isalnum((unsigned char)*t) || *t == '_' || *t == '.' || *t == '$'; t++)
+				;
+			name = string(s, t - s);
+			/* skip index registers and operators like lo(...) */
+			if (*t != '(' && !(b > buf && b[-1] == ',' && (strcmp(name, "X") == 0
+			|| strcmp(name, "Y") == 0 || strcmp(name, "FP") == 0))) {
+				struct sym *sym;
+				name = newname(f, name);
+				sym = lookup(name);
+				sym->used = 1;
+				for (r = p->refs; r && r->sym != sym; r = r->link)
+					;
+				if (r == NULL) {
+					r = alloc(sizeof *r);
+					r->sym = sym;
+					r->kind = 0;
+					r->link = p->refs;
+					p->refs = r;
+				}
+				r->kind |= kind;
+				kind = 0;
+			}
+			strcpy(b, name);
+			b += strlen(name);
+			s = t;
+		} else if (isdigit((unsigned char)*s)) {
+			while (isalnum((unsigned char)*s))
+				*b++ = *s++;
+		} else
+			*b++ = *s++;
+	strcpy(b, s);
+	lp->text = string(buf, strlen(buf));
+	lp->link = NULL;
+	*p->tail = lp;
+	p->tail = &lp->link;
+	p->size += size(lp->text);
+}
+
+/*
+ * splitfile - cut file i into objects: a function starts at a label
+ * preceded by a "; Function" comment or at any label not made up by rcc,
+ * and a data item at any label outside .text; other labels belong to
+ * the object they are in
+ */
+static void splitfile(int i) {
+	struct file *f = &files[i];
+	struct obj *p = NULL;
+	char *pending[64], op[32], *name, *rest;
+	int j, k, npending = 0, sect = TEXT, org = 0;
+
+	if (i == 0 && f->header > 0) {
+		header = newobj(string("_start", 6), 0, TEXT, 0);
+		for (j = 0; j < f->header; j++)
+			addline(header, f, f->lines[j]);
+		header->sect = -1;
+	}
+	for (j = f->header; j < f->nlines; j++) {
+		char *s = f->lines[j];
+		rest = directive(s, op, sizeof op);
+		name = labelof(s);
+		if (strcmp(s, "; End of program") == 0)
+			break;
+		if (strcmp(op, ".global") == 0 || strcmp(op, ".extern") == 0)
+			continue;
+		if (strncmp(s, "; Line table:", 13) == 0)
+			continue;
+		if (strncmp(s, "; line ", 7) == 0 && (rest = strchr(s + 7, ' ')) != NULL) {
+			struct lineent *e = alloc(sizeof *e);
+			e->sym = lookup(newname(f, string(s + 7, rest - (s + 7))));
+			e->coord = rest + 1;
+			e->link = NULL;
+			*linetail = e;
+			linetail = &e->link;
+			continue;
+		}
+		if (name == NULL && (op[0] == 0 || strcmp(op, ";") == 0 || op[0] == ';')) {
+			/* blank and comment lines go with what follows */
+			if (npending == NELEMS(pending)) {
+				if (p == NULL)
+					p = newobj(NULL, i, sect, org);
+				for (k = 0; k < npending; k++)
+					addline(p, f, pending[k]);
+				npending = 0;
+			}
+			pending[npending++] = s;
+			continue;
+		}
+		if (name == NULL && (strcmp(op, ".text") == 0 || strcmp(op, ".data") == 0
+		|| strcmp(op, ".rodata") == 0 || strcmp(op, ".bss") == 0 || strcmp(op, ".org") == 0)) {
+			for (sect = 0; strcmp(op, sectname[sect]) != 0; sect++)
+				;
+			if (sect == ORG)
+				org = strtol(rest, NULL, 0);
+			p = NULL;
+			continue;
+		}
+		if ((name && (sect != TEXT || !generated(name)
+		|| (npending > 0 && strncmp(pending[npending-1], "; Function", 10) == 0)))
+		|| p == NULL)
+			p = newobj(name ? newname(f, name) : NULL, i, sect, org);
+		if (name) {
+			struct sym *sym = lookup(newname(f, name));
+			if (sym->def && sym->def != p) {
+				fprintf(stderr, "%s: `%s' defined in %s and %s\n", progname,
+					name, files[sym->def->file].name, f->name);
+				errors++;
+			}
+			sym->def = p;
+		}
+		for (k = 0; k < npending; k++)
+			addline(p, f, pending[k]);
+		npending = 0;
+		addline(p, f, s);
+	}
+	/* the header's labels are defined once, by the first file */
+	if (i == 0 && header)
+		for (j = 0; j < f->header; j++)
+			if ((name = labelof(f->lines[j])) != NULL)
+				lookup(name)->def = header;
+}
+
+/* mark - mark p and everything it uses live */
+static void mark(struct obj *p) {
+	struct ref *r;
+
+	if (p->live)
+		return;
+	p->live = 1;
+	for (r = p->refs; r; r = r->link)
+		if (r->sym->def)
+			mark(r->sym->def);
+}
+
+/* emit - write the header and the live objects, section by section */
+static void emit(FILE *out) {
+	struct obj *p, *q;
+	struct line *lp;
+	struct lineent *e;
+	int sect, addr = 0x100, n = 0;
+
+	if (header) {
+		for (lp = header->lines; lp; lp = lp->link)
+			fprintf(out, "%s\n", lp->text);
+		header->addr = 0x100;
+		for (lp = header->lines; lp && strcmp(lp->text, "_start:") != 0; lp = lp->link)
+			;
+		for ( ; lp; lp = lp->link)
+			addr += size(lp->text);
+	}
+	for (sect = TEXT; sect < ORG; sect++) {
+		int base = addr;
+		for (p = objs; p && !(p->live && p->sect == sect); p = p->link)
+			;
+		if (p == NULL)
+			continue;
+		fprintf(out, "\n    %s\n", sectname[sect]);
+		for ( ; p; p = p->link)
+			if (p->live && p->sect == sect) {
+				p->addr = addr;
+				addr += p->size;
+				for (lp = p->lines; lp; lp = lp->link)
+					fprintf(out, "%s\n", lp->text);
+			}
+		/* the startup code moves .data and clears .bss a word at a time */
+		if ((sect == DATA || sect == BSS) && (addr - base)%2 != 0) {
+			fprintf(out, "    .space 1    ; pad to a word\n");
+			addr++;
+		}
+	}
+	if (addr > 0x10000) {
+		fprintf(stderr, "%s: image of %d bytes exceeds 64 KB\n", progname, addr);
+		errors++;
+	}
+	for (p = objs; p; p = p->link)
+		if (p->live && p->sect == ORG && p->org >= 0x100 && p->org < addr) {
+			fprintf(stderr, "%s: program runs into the .org block at 0x%x\n", progname, p->org);
+			errors++;
+			break;
+		}
+	/* .org blocks at the same address are laid out one after the other */
+	for (p = objs; p; p = p->link)
+		if (p->live && p->sect == ORG && p->addr == 0) {
+			int base = p->org;
+			fprintf(out, "\n    .org 0x%x\n", base);
+			for (q = p; q; q = q->link)
+				if (q->live && q->sect == ORG && q->org == p->org) {
+					q->addr = base;
+					base += q->size;
+					for (lp = q->lines; lp; lp = lp->link)
+						fprintf(out, "%s\n", lp->text);
+				}
+		}
+	for (e = lines; e; e = e->link)
+		if (e->sym->def && e->sym->def->live)
+			n++;
+	if (n > 0) {
+		fprintf(out, "\n; Line table: %d lines\n", n);
+		for (e = lines; e; e = e->link)
+			if (e->sym->def && e->sym->def->live)
+				fprintf(out, "; line %s %s\n", e->sym->name, e->coord);
+	}
+	fprintf(out, "\n; End of program\n    HLT\n");
+}
+
+/* printmap - list the live objects by address, then the removed ones */
+static void printmap(FILE *out) {
+	struct obj *p;
+	int sect, kept = 0, removed = 0;
+
+	fprintf(out, "Address  Size  Section  Symbol  File\n");
+	for (sect = TEXT; sect < NSECTS; sect++)
+		for (p = objs; p; p = p->link)
+			if (p->live && p->sect == sect) {
+				fprintf(out, "0x%04x %5d  %-8s %s  %s\n", p->addr, p->size,
+					sectname[sect], p->name ? p->name : "-", files[p->file].name);
+				kept += p->size;
+			}
+	for (p = objs; p; p = p->link)
+		if (!p->live && p->size > 0) {
+			if (removed == 0)
+				fprintf(out, "\nRemoved (unreachable from _start):\n");
+			fprintf(out, "       %5d  %-8s %s  %s\n", p->size,
+				p->sect >= 0 ? sectname[p->sect] : "", p->name ? p->name : "-",
+				files[p->file].name);
+			removed += p->size;
+		}
+	if (header)
+		kept += header->size;
+	fprintf(out, "\n%d bytes kept, %d bytes removed\n", kept, removed);
+}
+
+/*
+ * depth - the deepest stack p can reach: its own frame, plus for each
+ * callee the arguments p pushes, the return address and the callee's
+ * depth; a jump to another object (a stack entry stub's JMP) adds nothing
+ */
+static int depth(struct obj *p) {
+	struct ref *r;
+	int d, max = 0;
+
+	if (p->depth >= 0)
+		return p->depth;
+	if (p->visiting) {
+		fprintf(stderr, "%s: warning: `%s' is recursive; its stack depth is unbounded\n",
+			progname, p->name ? p->name : "-");
+		return 0;
+	}
+	p->visiting = 1;
+	for (r = p->refs; r; r = r->link) {
+		struct obj *q = r->sym->def;
+		if (q == NULL)
+			continue;
+		if (q == p && (r->kind&CALLED)) {
+			fprintf(stderr, "%s: warning: `%s' is recursive; its stack depth is unbounded\n",
+				progname, p->name ? p->name : "-");
+			continue;
+		}
+		if (q == p)
+			continue;
+		if (strcmp(r->sym->name, "_icall") == 0 && (r->kind&CALLED))
+			p->indirect = 1;
+		if (r->kind&CALLED)
+			d = p->args + 2 + depth(q);
+		else if (r->kind&JUMPED)
+			d = depth(q);
+		else
+			continue;
+		if (d > max) {
+			max = d;
+			p->deepest = q;
+		}
+	}
+	p->visiting = 0;
+	return p->depth = p->frame + max;
+}
+
+/* checkstack - warn if the deepest stack overruns the data below it; list depths on out */
+static void checkstack(FILE *out) {
+	struct obj *p;
+	int d = depth(header), base = STACKBASE, indirect = 0;
+
+	/* .org blocks below the code (e.g. -hotdata) raise the stack's floor */
+	for (p = objs; p; p = p->link)
+		if (p->live && p->sect == ORG && p->addr < 0x100 && p->addr + p->size > base)
+			base = p->addr + p->size;
+	for (p = objs; p; p = p->link)
+		if (p->live && p->indirect)
+			indirect++;
+	if (out) {
+		fprintf(out, "\nFrame  Args  Depth  Function  Deepest callee\n");
+		for (p = objs; p; p = p->link)
+			if (p->live && p->sect == TEXT && p->name && p->depth >= 0)
+				fprintf(out, "%5d %5d  %5d  %s%s  %s\n", p->frame, p->args, p->depth,
+					p->name, p->indirect ? " (indirect calls)" : "",
+					p->deepest && p->deepest->name ? p->deepest->name : "-");
+		fprintf(out, "\nWorst-case stack: %d of %d bytes (0x%x-0x%x):", d,
+			STACKTOP - base + 1, base, STACKTOP);
+		for (p = header; p; p = p->deepest)
+			fprintf(out, " %s", p->name ? p->name : "-");
+		fprintf(out, "\n");
+		if (indirect)
+			fprintf(out, "Calls through function pointers in %d function%s are not counted\n",
+				indirect, indirect > 1 ? "s" : "");
+	}
+	if (d > STACKTOP - base + 1) {
+		fprintf(stderr, "%s: warning: worst-case stack depth of %d bytes exceeds the %d bytes between 0x%x and 0x%x:",
+			progname, d, STACKTOP - base + 1, base, STACKTOP);
+		for (p = header; p; p = p->deepest)
+			fprintf(stderr, " %s", p->name ? p->name : "-");
+		fprintf(stderr, "\n");
+	}
+}
@@ -0,0 +1,275 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* nxprof [ -o file ] [ -a address ] program.s dump...
+ * write prof.out from the -b counters in NEANDER-X memory dumps
+ *
+ * rcc -target=neanderx -b lays out each unit's 32-bit point counters in
+ * a .org block, one ".long 0 ; file x y" per point, and marks the first
+ * point of each function with "; function name file x y".  nxprof finds
+ * those blocks in the program's assembly (as linked by nxld, or a
+ * single unit from rcc), reads the counters at their addresses in each
+ * dump (raw little-endian memory, starting at address 0 or -a address),
+ * and appends one prof.out entry per unit and dump, as lib/bbexit.c does
+ * on hosted targets.  A function's call count is the count of its first
+ * point, which is at its opening brace.  bprint annotates the result.
+ */
+
+static char rcsid[] = "$Id$";
+
+struct point {
+	int file;		/* index in unit's files, from 1 */
+	int x, y;
+	unsigned addr;		/* address of the counter */
+	char *func;		/* function entered here, or NULL */
+	int fx, fy, ffile;	/* that function's coordinate */
+};
+
+struct unit {
+	char *files[64];
+	int nfiles;
+	struct point *points;
+	int npoints;
+	struct unit *link;
+};
+
+char *progname;
+static struct unit *units, **unittail = &units;
+
+void *alloc(unsigned);
+static char *strsave(char *);
+static int fileindex(struct unit *, char *);
+static void readprogram(char *);
+static unsigned char *readdump(char *, unsigned long *);
+static void profout(struct unit *, unsigned char *, unsigned long, unsigned long, FILE *);
+
+int main(int argc, char *argv[]) {
+	char *outfile = "prof.out";
+	unsigned long base = 0, size;
+	unsigned char *mem;
+	struct unit *u;
+	FILE *fp;
+	int i;
+
+	progname = argv[0];
+	for (i = 1; i < argc && *argv[i] == '-'; i++)
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			outfile = argv[++i];
+		else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+			base = strtoul(argv[++i], NULL, 0);
+		else
+			break;
+	if (argc - i < 2) {
+		fprintf(stderr, "usage: %s [ -o file ] [ -a address ] program.s dump...\n", progname);
+		exit(1);
+	}
+	readprogram(argv[i++]);
+	if (units == NULL) {
+		fprintf(stderr, "%s: no -b counters in `%s'\n", progname, argv[i-1]);
+		exit(1);
+	}
+	if ((fp = fopen(outfile, "a")) == NULL) {
+		fprintf(stderr, "%s: can't write `%s'\n", progname, outfile);
+		exit(1);
+	}
+	for ( ; i < argc; i++) {
+		mem = readdump(argv[i], &size);
+		for (u = units; u; u = u->link)
+			profout(u, mem, base, size, fp);
+		free(mem);
+	}
+	if (fclose(fp) == EOF) {
+		fprintf(stderr, "%s: error writing `%s'\n", progname, outfile);
+		exit(1);
+	}
+	return 0;
+}
+
+/* alloc - allocate n bytes or die */
+void *alloc(unsigned n) {
+	void *new = malloc(n);
+
+	if (new == NULL) {
+		fprintf(stderr, "%s: out of memory\n", progname);
+		exit(1);
+	}
+	return new;
+}
+
+/* strsave - return a copy of s */
+static char *strsave(char *s) {
+	return strcpy(alloc(strlen(s) + 1), s);
+}
+
+/* fileindex - return name's index in u's files, adding it if necessary */
+static int fileindex(struct unit *u, char *name) {
+	int i;
+
+	for (i = 0; i < u->nfiles; i++)
+		if (strcmp(u->files[i], name) == 0)
+			return i + 1;
+	if (u->nfiles == sizeof u->files/sizeof u->files[0]) {
+		fprintf(stderr, "%s: too many files in one unit\n", progname);
+		exit(1);
+	}
+	u->files[u->nfiles++] = strsave(name);
+	return u->nfiles;
+}
+
+/* datasize - bytes of data in directive op with operands s, or -1 */
+static int datasize(char *op, char *s) {
+	int n;
+
+	if (strcmp(op, ".space") == 0)
+		return atoi(s);
+	if (strcmp(op, ".byte") == 0 || strcmp(op, ".word") == 0 || strcmp(op, ".long") == 0) {
+		for (n = 1; *s && *s != ';'; s++)
+			if (*s == ',')
+				n++;
+		return n*(op[1] == 'b' ? 1 : op[1] == 'w' ? 2 : 4);
+	}
+	if (strcmp(op, ".ascii") == 0 || strcmp(op, ".asciz") == 0) {
+		n = op[5] == 'z';
+		if ((s = strchr(s, '"')) != NULL) {
+			for (s++; *s && *s != '"'; s++, n++)
+				if (*s == '\\' && isdigit((unsigned char)s[1]))
+					s += 3;
+				else if (*s == '\\')
+					s++;
+		}
+		return n;
+	}
+	return -1;
+}
+
+/*
+ * readprogram - find the counter blocks in file; addresses are known
+ * exactly only in .org blocks, which hold nothing but data
+ */
+static void readprogram(char *file) {
+	char buf[1024], op[32], name[512], func[512], ffile[512];
+	struct unit *u = NULL;
+	unsigned long addr = 0;
+	int inorg = 0, left = 0, fx = 0, fy = 0, pending = 0;
+	FILE *fp;
+
+	if ((fp = fopen(file, "r")) == NULL) {
+		fprintf(stderr, "%s: can't read `%s'\n", progname, file);
+		exit(1);
+	}
+	while (fgets(buf, sizeof buf, fp)) {
+		char *s = buf, *t;
+		int n, x, y;
+		if (sscanf(buf, "; Basic-block counters for %511[^:]: %d points", name, &n) == 2) {
+			u = alloc(sizeof *u);
+			u->nfiles = u->npoints = 0;
+			u->points = alloc((n > 0 ? n : 1)*sizeof *u->points);
+			u->link = NULL;
+			*unittail = u;
+			unittail = &u->link;
+			fileindex(u, name);
+			left = n;
+			continue;
+		}
+		if (left > 0 && sscanf(buf, "; function %511s %511s %d %d", func, ffile, &x, &y) == 4) {
+			fx = x;
+			fy = y;
+			pending = 1;
+			continue;
+		}
+		/* skip a label; get the directive */
+		for (t = s; isalnum((unsigned char)*t) || *t == '_' || *t == '.' || *t == '$'; t++)
+			;
+		if (t > s && *t == ':')
+			s = t + 1;
+		while (*s == ' ' || *s == '\t')
+			s++;
+		for (n = 0; *s && !isspace((unsigned char)*s) && *s != ';' && n < (int)sizeof op - 1; n++)
+			op[n] = *s++;
+		op[n] = 0;
+		if (op[0] == 0)
+			continue;
+		if (strcmp(op, ".org") == 0) {
+			addr = strtoul(s, NULL, 0);
+			inorg = 1;
+			continue;
+		}
+		if (!inorg)
+			continue;
+		if ((n = datasize(op, s)) < 0) {
+			inorg = 0;	/* a section or an instruction: sizes unknown */
+			continue;
+		}
+		if (left > 0 && u && strcmp(op, ".long") == 0) {
+			struct point *p = &u->points[u->npoints++];
+			left--;
+			p->addr = addr;
+			p->file = p->x = p->y = 0;
+			if ((t = strchr(s, ';')) != NULL
+			&& sscanf(t, "; %511s %d %d", name, &p->x, &p->y) == 3)
+				p->file = fileindex(u, name);
+			p->func = NULL;
+			if (pending) {
+				p->func = strsave(func);
+				p->ffile = fileindex(u, ffile);
+				p->fx = fx;
+				p->fy = fy;
+			}
+			pending = 0;
+		}
+		addr += n;
+	}
+	fclose(fp);
+}
+
+/* readdump - read the memory dump in file, returning its contents and size */
+static unsigned char *readdump(char *file, unsigned long *size) {
+	unsigned long n = 0, max = 0x10000;
+	unsigned char *mem = alloc(max);
+	FILE *fp;
+	int c;
+
+	if ((fp = fopen(file, "rb")) == NULL) {
+		fprintf(stderr, "%s: can't read `%s'\n", progname, file);
+		exit(1);
+	}
+	while ((c = getc(fp)) != EOF && n < max)
+		mem[n++] = c;
+	fclose(fp);
+	*size = n;
+	return mem;
+}
+
+/* profout - append u's counts in mem, which holds addresses base..base+size-1, to fp */
+static void profout(struct unit *u, unsigned char *mem, unsigned long base, unsigned long size, FILE *fp) {
+	unsigned long *counts = alloc((u->npoints + 1)*sizeof *counts);
+	int i, nfuncs = 0;
+
+	for (i = 0; i < u->npoints; i++) {
+		unsigned long a = u->points[i].addr;
+		unsigned char *m;
+		if (a < base || a + 4 > base + size) {
+			fprintf(stderr, "%s: counter at 0x%lx is not in the dump\n", progname, a);
+			exit(1);
+		}
+		m = &mem[a - base];
+		counts[i] = m[0] | m[1]<<8 | (unsigned long)m[2]<<16 | (unsigned long)m[3]<<24;
+		if (u->points[i].func)
+			nfuncs++;
+	}
+	fprintf(fp, "%d\n", u->nfiles);
+	for (i = 0; i < u->nfiles; i++)
+		fprintf(fp, "%s\n", u->files[i]);
+	fprintf(fp, "%d\n", nfuncs);
+	for (i = 0; i < u->npoints; i++)
+		if (u->points[i].func)
+			fprintf(fp, "%s %d %d %d %lu ? ? 0 0\n", u->points[i].func, u->points[i].ffile,
+				u->points[i].fx, u->points[i].fy, counts[i]);
+	fprintf(fp, "%d\n", u->npoints);
+	for (i = 0; i < u->npoints; i++)
+		fprintf(fp, "%d %d %d %lu\n", u->points[i].file, u->points[i].x,
+			u->points[i].y, counts[i]);
+	free(counts);
+}
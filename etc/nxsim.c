@@ -0,0 +1,959 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* nxsim [ -i port=file ]... [ -o port=file ]... [ -d dump ] [ -n count ] [ -l ] [ -v ] file
+ * assemble and run a NEANDER-X program
+ *
+ * nxsim assembles the output of rcc -target=neanderx or nxld into a
+ * 64 KB memory, with .org blocks where they say and the .text, .data,
+ * .rodata and .bss sections, each gathered from all its pieces, one
+ * after another from the end of the header's .org 0x0100 block, and
+ * runs it from address 0 until HLT.  Sections start at even addresses.
+ * .bss is not part of the image: nothing is stored there, and the
+ * startup code clears it between __bss_start and __bss_end.  nxsim
+ * defines those and __data_start, __data_end and __data_load, where
+ * .data's image is loaded; .data is loaded in place, so __data_load is
+ * __data_start and the startup code's copy is skipped.  Instructions are
+ * encoded as nxld sizes them: an opcode byte, then a little-endian word
+ * if there is an operand.  The opcode numbers are nxsim's own.
+ *
+ * nxsim is a functional simulator: it counts instructions, not cycles.
+ * Each basic block is decoded once, when it is first reached, into an
+ * array of micro-operations with their operands and addresses resolved;
+ * indexed and indirect operands become a separate micro-operation that
+ * computes the address.  Decoded blocks are cached by address, and a
+ * store into a byte of any decoded block discards the cache.  The
+ * dispatch loop is direct threaded when the host compiler has computed
+ * gotos and a switch otherwise.
+ *
+ * IN and OUT transfer a byte between AC and the file bound to the port
+ * with -i and -o; port 0 is bound to the standard input and output.  IN
+ * reads 0xFFFF at the end of its file, and unbound ports read 0 and
+ * discard what is written.  -d writes the memory at the end of the run,
+ * e.g. for nxprof and nxtrace, and -l uses the line table of
+ * rcc -Wf-lines to count the instructions executed for each source line.
+ * The exit status is the low byte of AC at HLT, or 99 (FAIL) when nxsim
+ * cannot assemble or finish the program, so a test can tell the two apart.
+ */
+
+static char rcsid[] = "$Id$";
+
+#define NELEMS(a) ((int)(sizeof (a)/sizeof ((a)[0])))
+#define MAXBLOCK 64		/* most instructions in a block */
+#define FAIL 99			/* exit status for nxsim's own errors */
+
+/*
+ * Micro-operations.  A memory instruction with a constant address is
+ * one micro-operation; with an indexed or indirect address it is an EA
+ * micro-operation, which leaves the address in ea, followed by the _E
+ * form of the instruction, which immediately follows its plain form.
+ */
+#define UOPS \
+xx(LDA)  xx(LDA_E)  xx(STA)  xx(STA_E)  xx(ADD)  xx(ADD_E)  xx(SUB)  xx(SUB_E) \
+xx(ADC)  xx(ADC_E)  xx(SBC)  xx(SBC_E)  xx(AND)  xx(AND_E)  xx(OR)   xx(OR_E) \
+xx(XOR)  xx(XOR_E)  xx(CMP)  xx(CMP_E)  xx(PUSH_ADDR) xx(PUSH_ADDR_E) \
+xx(POP_ADDR) xx(POP_ADDR_E) \
+xx(EAX)  xx(EAY)    xx(EAFP) xx(EAIND)  xx(EAINDY) \
+xx(LDI)  xx(LDXI)   xx(LDYI) xx(CMPI)   xx(MULI) xx(DIVI)  xx(IN)   xx(OUT) \
+xx(TAX)  xx(TXA)    xx(TAY)  xx(TYA)    xx(SWPX) xx(SWPY) \
+xx(INX)  xx(INY)    xx(DEX)  xx(DEY)    xx(INC)  xx(DEC)   xx(NEG)  xx(NOT) \
+xx(SHL)  xx(SHR)    xx(ASR) \
+xx(ADDX) xx(SUBX)   xx(ANDX) xx(ORX)    xx(XORX) xx(MUL)   xx(DIV)  xx(MOD) \
+xx(PUSH) xx(POP)    xx(PUSH_FP) xx(POP_FP) xx(TSF) xx(TFS) xx(NOP) \
+xx(JMP)  xx(JZ)     xx(JNZ)  xx(JN)     xx(JC)   xx(JNC)   xx(JLE)  xx(JGT) \
+xx(JGE)  xx(JBE)    xx(JA)   xx(CALL)   xx(RET)  xx(HLT) \
+xx(END)  xx(ILLEGAL)
+
+enum {
+#define xx(x) x,
+UOPS
+#undef xx
+NUOPS };
+
+static char *uopname[] = {
+#define xx(x) #x,
+UOPS
+#undef xx
+};
+
+#if defined(__GNUC__) && !defined(NOTHREAD)
+#define THREADED 1
+#endif
+
+/* addressing modes */
+enum { NONE, IMM, ABS, IDXX, IDXY, IDXFP, IND, INDY, NMODES };
+
+static struct opcode {		/* an opcode byte's instruction */
+	int uop;
+	int mode;
+} opcodes[256];
+static int nopcodes = 1;	/* opcode 0 is illegal */
+
+struct uop {			/* a decoded micro-operation */
+	int op;
+#ifdef THREADED
+	void *label;		/* its handler */
+#endif
+	unsigned a;		/* operand, address or target */
+	unsigned short pc;	/* address of its instruction */
+	unsigned short next;	/* address of the next instruction */
+	int left;		/* instructions after it in the block */
+};
+
+struct block {			/* a decoded basic block */
+	unsigned pc;
+	int n;			/* instructions */
+	unsigned long count;	/* times entered */
+	struct uop *ops;
+	int nops;
+	struct block *link;
+};
+
+struct sym {			/* an assembler label */
+	char *name;
+	long value;
+	int defined;
+	int sect;		/* section it is in, or -1 */
+	struct sym *link;
+};
+
+struct lineent {		/* an entry in a -Wf-lines table */
+	char *label;
+	char *coord;
+	unsigned addr;
+	unsigned long count;
+};
+
+char *progname;
+static unsigned char mem[0x10000];
+static unsigned char incode[0x10000];	/* byte is in a decoded block */
+static struct block *cache[0x10000];	/* decoded blocks by address */
+static struct block *blocks;		/* all decoded blocks */
+static unsigned long nblocks, nflushes;
+static void **labels;			/* handlers by micro-operation */
+static FILE *inport[256], *outport[256];
+static struct sym *symtab[1024];
+static char *filename;
+static int lineno, pass, errors;
+static unsigned loc;			/* location counter */
+static int inorg;			/* in an .org block, not a section */
+enum { TEXT, DATA, RODATA, BSS, NSECTS };
+static char *sectname[] = { ".text", ".data", ".rodata", ".bss" };
+static int sect = -1;			/* current section */
+static unsigned sectloc[NSECTS];	/* each section's location counter */
+static unsigned sectbase[NSECTS];	/* its address; 0 in pass 1 */
+static unsigned headerend;		/* end of the header's .org block */
+static struct lineent *linetab;
+static int nlinetab, maxlinetab;
+static int *lineof;			/* lineof[addr]: index in linetab, or -1 */
+
+void *alloc(unsigned);
+static void assemble(char *);
+static void error(char *, char *);
+static struct block *decode(unsigned);
+static void flush(void);
+static void linecounts(void);
+static int run(unsigned long, unsigned long *);
+static void setup(void);
+
+int main(int argc, char *argv[]) {
+	char *dump = NULL;
+	unsigned long limit = 0, insts = 0;
+	int i, port, status, verbose = 0, lines = 0;
+	clock_t t0;
+
+	progname = argv[0];
+	inport[0] = stdin;
+	outport[0] = stdout;
+	for (i = 1; i < argc && *argv[i] == '-'; i++)
+		if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "-o") == 0) && i + 1 < argc) {
+			char *s = argv[i+1], *mode = argv[i][1] == 'i' ? "rb" : "wb";
+			FILE *fp;
+			port = strtol(s, &s, 0);
+			if (*s != '=' || port < 0 || port > 255) {
+				fprintf(stderr, "%s: bad port binding `%s'\n", progname, argv[i+1]);
+				exit(FAIL);
+			}
+			if ((fp = fopen(s + 1, mode)) == NULL) {
+				fprintf(stderr, "%s: can't open `%s'\n", progname, s + 1);
+				exit(FAIL);
+			}
+			if (argv[i][1] == 'i')
+				inport[port] = fp;
+			else
+				outport[port] = fp;
+			i++;
+		} else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+			dump = argv[++i];
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			limit = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-l") == 0)
+			lines++;
+		else if (strcmp(argv[i], "-v") == 0)
+			verbose++;
+		else
+			break;
+	if (i != argc - 1) {
+		fprintf(stderr, "usage: %s [ -i port=file ]... [ -o port=file ]... "
+			"[ -d dump ] [ -n count ] [ -l ] [ -v ] file\n", progname);
+		exit(FAIL);
+	}
+	setup();
+	assemble(argv[i]);
+	if (errors)
+		exit(FAIL);
+	t0 = clock();
+	status = run(limit, &insts);
+	if (verbose) {
+		double secs = (double)(clock() - t0)/CLOCKS_PER_SEC;
+		fprintf(stderr, "%s: %lu instructions in %.3f seconds", progname, insts, secs);
+		if (secs > 0)
+			fprintf(stderr, " (%.1f MIPS)", insts/secs/1e6);
+		fprintf(stderr, ", %lu blocks decoded, %lu flushes\n", nblocks, nflushes);
+	}
+	if (lines)
+		linecounts();
+	if (dump) {
+		FILE *fp = fopen(dump, "wb");
+		if (fp == NULL || fwrite(mem, 1, sizeof mem, fp) != sizeof mem || fclose(fp) == EOF) {
+			fprintf(stderr, "%s: can't write `%s'\n", progname, dump);
+			exit(FAIL);
+		}
+	}
+	for (port = 0; port < 256; port++)
+		if (outport[port] && fflush(outport[port]) == EOF) {
+			fprintf(stderr, "%s: error writing port %d\n", progname, port);
+			exit(FAIL);
+		}
+	return status;
+}
+
+/* alloc - allocate n bytes or die */
+void *alloc(unsigned n) {
+	void *new = malloc(n);
+
+	if (new == NULL) {
+		fprintf(stderr, "%s: out of memory\n", progname);
+		exit(FAIL);
+	}
+	return new;
+}
+
+/* error - report an assembly error at the current line */
+static void error(char *msg, char *arg) {
+	if (pass == 2 || strncmp(msg, "undefined", 9) != 0) {
+		fprintf(stderr, "%s: %s:%d: ", progname, filename, lineno);
+		fprintf(stderr, msg, arg);
+		fprintf(stderr, "\n");
+		errors++;
+	}
+}
+
+/* opcode - assign the next opcode byte to uop in mode */
+static void opcode(int uop, int mode) {
+	opcodes[nopcodes].uop = uop;
+	opcodes[nopcodes].mode = mode;
+	nopcodes++;
+}
+
+/* setup - number the opcodes */
+static void setup(void) {
+	static int memops[] = { LDA, STA, ADD, SUB, ADC, SBC, AND, OR, XOR, CMP,
+		PUSH_ADDR, POP_ADDR };
+	static int immops[] = { LDI, LDXI, LDYI, CMPI, MULI, DIVI, IN, OUT };
+	static int jumps[] = { JMP, JZ, JNZ, JN, JC, JNC, JLE, JGT, JGE, JBE, JA, CALL };
+	int i, m;
+
+	for (i = 0; i < NELEMS(memops); i++)
+		for (m = ABS; m < NMODES; m++)
+			opcode(memops[i], m);
+	for (i = 0; i < NELEMS(immops); i++)
+		opcode(immops[i], IMM);
+	for (i = 0; i < NELEMS(jumps); i++)
+		opcode(jumps[i], ABS);
+	for (i = TAX; i <= NOP; i++)
+		opcode(i, NONE);
+	opcode(RET, NONE);
+	opcode(HLT, NONE);
+}
+
+/* findop - return the opcode byte for the instruction name in mode, or 0 */
+static int findop(char *name, int mode) {
+	int i, named = 0;
+
+	for (i = 1; i < nopcodes; i++)
+		if (strcmp(uopname[opcodes[i].uop], name) == 0) {
+			named = 1;
+			if (opcodes[i].mode == mode || (opcodes[i].mode == IMM && mode == ABS))
+				return i;
+		}
+	return named ? -1 : 0;
+}
+
+/* lookup - the label named name[0..len-1], installing it if necessary */
+static struct sym *lookup(char *name, int len) {
+	unsigned h = 0;
+	struct sym *p;
+	int i;
+
+	for (i = 0; i < len; i++)
+		h = (h<<1) + name[i];
+	h &= NELEMS(symtab) - 1;
+	for (p = symtab[h]; p; p = p->link)
+		if (strncmp(p->name, name, len) == 0 && p->name[len] == 0)
+			return p;
+	p = alloc(sizeof *p);
+	p->name = alloc(len + 1);
+	strncpy(p->name, name, len);
+	p->name[len] = 0;
+	p->value = 0;
+	p->defined = 0;
+	p->sect = -1;
+	p->link = symtab[h];
+	symtab[h] = p;
+	return p;
+}
+
+static int issym(int c) {
+	return isalnum(c) || c == '_' || c == '.' || c == '$';
+}
+
+static char *skip(char *s) {
+	while (*s == ' ' || *s == '\t')
+		s++;
+	return s;
+}
+
+/* expr - evaluate the expression at *s: terms joined by + and -, where a term is -term, a number, a label, lo(expr) or hi(expr) */
+static long expr(char **s) {
+	long v = 0, t;
+	int sign = 1;
+
+	for (;;) {
+		char *p = skip(*s);
+		int neg = 0;
+		while (*p == '-' || *p == '+') {
+			neg ^= *p == '-';
+			p = skip(p + 1);
+		}
+		if (isdigit((unsigned char)*p))
+			t = strtol(p, &p, 0);
+		else if ((strncmp(p, "lo(", 3) == 0 || strncmp(p, "hi(", 3) == 0)) {
+			int hi = *p == 'h';
+			p += 3;
+			t = expr(&p);
+			if (*p == ')')
+				p++;
+			else
+				error("missing `)'", NULL);
+			t = hi ? (t >> 16) & 0xFFFF : t & 0xFFFF;
+		} else if (issym((unsigned char)*p)) {
+			char *q = p;
+			struct sym *sym;
+			while (issym((unsigned char)*p))
+				p++;
+			sym = lookup(q, p - q);
+			if (!sym->defined)
+				error("undefined symbol `%s'", sym->name);
+			t = sym->value;
+		} else {
+			error("bad expression `%s'", p);
+			*s = p + strlen(p);
+			return v;
+		}
+		v += sign*(neg ? -t : t);
+		p = skip(p);
+		*s = p;
+		if (*p == '+')
+			sign = 1;
+		else if (*p == '-')
+			sign = -1;
+		else
+			return v;
+		*s = p + 1;
+	}
+}
+
+/* emitbyte - store b at the location counter and advance it */
+static void emitbyte(long b) {
+	if (pass == 2 && !(sect == BSS && !inorg)) {
+		if (incode[loc]) {
+			char buf[16];
+			sprintf(buf, "0x%04x", loc);
+			error("a second byte for address %s", buf);
+		}
+		mem[loc] = b;
+		incode[loc] = 1;
+	}
+	loc = (loc + 1) & 0xFFFF;
+}
+
+static void emitword(long w) {
+	emitbyte(w & 0xFF);
+	emitbyte((w >> 8) & 0xFF);
+}
+
+/* ascii - emit the bytes of the quoted string at s */
+static void ascii(char *s, int nul) {
+	s = skip(s);
+	if (*s++ != '"') {
+		error("missing string", NULL);
+		return;
+	}
+	while (*s && *s != '"') {
+		int c = *s++;
+		if (c == '\\' && *s >= '0' && *s <= '7') {
+			c = 0;
+			while (*s >= '0' && *s <= '7')
+				c = 8*c + *s++ - '0';
+		} else if (c == '\\') {
+			c = *s++;
+			c = c == 'n' ? '\n' : c == 't' ? '\t' : c;
+		}
+		emitbyte(c);
+	}
+	if (nul)
+		emitbyte(0);
+}
+
+/* instruction - assemble the instruction op with operand s */
+static void instruction(char *op, char *s) {
+	int mode = NONE, code;
+	long a = 0;
+
+	s = skip(s);
+	if (*s == '(') {
+		s++;
+		a = expr(&s);
+		if (*s++ != ')')
+			error("missing `)'", NULL);
+		mode = IND;
+		s = skip(s);
+		if (*s == ',') {
+			s = skip(s + 1);
+			if (toupper(*s) == 'Y')
+				mode = INDY, s++;
+			else
+				error("bad index register", NULL);
+		}
+	} else if (*s) {
+		a = expr(&s);
+		mode = ABS;
+		if (*s == ',') {
+			s = skip(s + 1);
+			if (strncmp(s, "FP", 2) == 0)
+				mode = IDXFP, s += 2;
+			else if (*s == 'X')
+				mode = IDXX, s++;
+			else if (*s == 'Y')
+				mode = IDXY, s++;
+			else
+				error("bad index register", NULL);
+		}
+	}
+	if (*skip(s))
+		error("junk after operand: `%s'", s);
+	code = findop(op, mode);
+	if (code == 0) {
+		error("unknown instruction `%s'", op);
+		return;
+	} else if (code < 0) {
+		error("bad operand for `%s'", op);
+		return;
+	}
+	emitbyte(code);
+	if (mode != NONE)
+		emitword(a);
+}
+
+/* directive - assemble directive op with arguments s */
+static void directive(char *op, char *s) {
+	long n;
+
+	int i;
+
+	for (i = 0; i < NSECTS && strcmp(op, sectname[i]) != 0; i++)
+		;
+	if (strcmp(op, ".org") == 0) {
+		if (!inorg)
+			sectloc[sect] = loc;
+		inorg = 1;
+		loc = expr(&s) & 0xFFFF;
+	} else if (i < NSECTS) {
+		if (sect < 0)
+			headerend = loc;
+		else if (!inorg)
+			sectloc[sect] = loc;
+		inorg = 0;
+		loc = sectloc[sect = i];
+	} else if (strcmp(op, ".byte") == 0 || strcmp(op, ".word") == 0
+	|| strcmp(op, ".long") == 0)
+		for (;;) {
+			n = expr(&s);
+			emitbyte(n);
+			if (op[1] != 'b')
+				emitbyte(n >> 8);
+			if (op[1] == 'l') {
+				emitbyte(n >> 16);
+				emitbyte(n >> 24);
+			}
+			if (*s != ',')
+				break;
+			s++;
+		}
+	else if (strcmp(op, ".space") == 0)
+		for (n = expr(&s); n > 0; n--)
+			emitbyte(0);
+	else if (strcmp(op, ".ascii") == 0 || strcmp(op, ".asciz") == 0)
+		ascii(s, op[5] == 'z');
+	else if (strcmp(op, ".global") != 0 && strcmp(op, ".extern") != 0)
+		error("unknown directive `%s'", op);
+}
+
+/* addrcmp - compare line table entries by address */
+static int addrcmp(const void *x, const void *y) {
+	const struct lineent *p = x, *q = y;
+
+	return p->addr < q->addr ? -1 : p->addr > q->addr;
+}
+
+/* define - define name as value unless the program does */
+static void define(char *name, unsigned value) {
+	struct sym *sym = lookup(name, strlen(name));
+
+	if (!sym->defined) {
+		sym->defined = 1;
+		sym->value = value;
+		sym->sect = -1;
+	}
+}
+
+/*
+ * layout - place the sections one after another from the end of the
+ * header, even-aligned, and move their labels there
+ */
+static void layout(void) {
+	unsigned addr = (headerend + 1) & ~1;
+	int i;
+
+	for (i = 0; i < NSECTS; i++) {
+		sectbase[i] = addr;
+		addr += (sectloc[i] + 1) & ~1;
+	}
+	for (i = 0; i < NELEMS(symtab); i++) {
+		struct sym *p;
+		for (p = symtab[i]; p; p = p->link)
+			if (p->defined && p->sect >= 0)
+				p->value = (p->value + sectbase[p->sect]) & 0xFFFF;
+	}
+	define("__data_start", sectbase[DATA]);
+	define("__data_end", sectbase[RODATA]);
+	define("__data_load", sectbase[DATA]);
+	define("__bss_start", sectbase[BSS]);
+	define("__bss_end", addr);
+	if (addr > 0x10000)
+		error("the sections end past 64 KB", NULL);
+}
+
+/* assemble - assemble file name in two passes, then bind the line table */
+static void assemble(char *name) {
+	char buf[1024], op[32], *s, *t;
+	FILE *fp;
+	int i, j;
+
+	if ((fp = fopen(name, "r")) == NULL) {
+		fprintf(stderr, "%s: can't read `%s'\n", progname, name);
+		exit(FAIL);
+	}
+	filename = name;
+	for (pass = 1; pass <= 2; pass++) {
+		rewind(fp);
+		lineno = 0;
+		loc = 0;
+		inorg = 1;
+		sect = -1;
+		memcpy(sectloc, sectbase, sizeof sectloc);
+		while (fgets(buf, sizeof buf, fp)) {
+			lineno++;
+			if (pass == 1 && strncmp(buf, "; line ", 7) == 0
+			&& (s = strchr(buf + 7, ' ')) != NULL) {
+				struct lineent *e;
+				if (nlinetab == maxlinetab) {
+					struct lineent *v = alloc((2*maxlinetab + 64)*sizeof *v);
+					if (linetab) {
+						memcpy(v, linetab, nlinetab*sizeof *v);
+						free(linetab);
+					}
+					linetab = v;
+					maxlinetab = 2*maxlinetab + 64;
+				}
+				e = &linetab[nlinetab++];
+				*s = 0;
+				e->label = strcpy(alloc(strlen(buf + 7) + 1), buf + 7);
+				s[strcspn(s + 1, "\r\n") + 1] = 0;
+				e->coord = strcpy(alloc(strlen(s + 1) + 1), s + 1);
+				e->count = 0;
+				continue;
+			}
+			/* strip the comment, leaving strings alone */
+			for (s = buf; *s && *s != ';' && *s != '\n' && *s != '\r'; s++)
+				if (*s == '"')
+					for (s++; *s && *s != '"'; s++)
+						if (*s == '\\' && s[1])
+							s++;
+			*s = 0;
+			s = buf;
+			if (issym((unsigned char)*s)) {
+				for (t = s; issym((unsigned char)*t); t++)
+					;
+				if (*t != ':') {
+					error("bad label or instruction `%s'", s);
+					continue;
+				}
+				if (pass == 1) {
+					struct sym *sym = lookup(s, t - s);
+					if (sym->defined)
+						error("`%s' is defined twice", sym->name);
+					sym->defined = 1;
+					sym->value = loc;
+					sym->sect = inorg ? -1 : sect;
+				}
+				s = t + 1;
+			}
+			s = skip(s);
+			if (*s == 0)
+				continue;
+			for (t = s; *t && *t != ' ' && *t != '\t'; t++)
+				;
+			if (t - s >= (int)sizeof op) {
+				error("unknown instruction `%s'", s);
+				continue;
+			}
+			strncpy(op, s, t - s);
+			op[t - s] = 0;
+			if (op[0] == '.')
+				directive(op, t);
+			else
+				instruction(op, t);
+		}
+		if (!inorg && sect >= 0)
+			sectloc[sect] = loc;
+		if (pass == 1 && !errors)
+			layout();
+		if (errors)
+			break;
+	}
+	fclose(fp);
+	memset(incode, 0, sizeof incode);
+	if (nlinetab == 0)
+		return;
+	/* each line's code runs from its label to the next line's label */
+	for (i = 0; i < nlinetab; i++) {
+		struct sym *sym = lookup(linetab[i].label, strlen(linetab[i].label));
+		if (!sym->defined) {
+			fprintf(stderr, "%s: line table label `%s' is not defined\n",
+				progname, sym->name);
+			linetab[i].addr = 0x10000;
+		} else
+			linetab[i].addr = sym->value;
+	}
+	qsort(linetab, nlinetab, sizeof *linetab, addrcmp);
+	lineof = alloc(0x10000*sizeof *lineof);
+	for (i = j = 0; i < 0x10000; i++) {
+		while (j < nlinetab && linetab[j].addr <= (unsigned)i)
+			j++;
+		lineof[i] = j - 1;
+	}
+}
+
+/* decode - decode the block at pc and cache it */
+static struct block *decode(unsigned pc) {
+	struct uop buf[2*MAXBLOCK + 1], *u = buf;
+	int index[2*MAXBLOCK + 1];	/* instruction number of buf[i] */
+	struct block *b = alloc(sizeof *b);
+	int i, n = 0, done = 0;
+
+	b->pc = pc;
+	b->count = 0;
+	while (!done) {
+		struct opcode *o = &opcodes[mem[pc]];
+		unsigned next = (pc + (o->mode == NONE ? 1 : 3)) & 0xFFFF;
+		unsigned a = o->mode == NONE ? 0 : mem[(pc+1)&0xFFFF] | mem[(pc+2)&0xFFFF]<<8;
+		if (mem[pc] == 0 || mem[pc] >= nopcodes) {
+			u->op = ILLEGAL;
+			u->a = u->pc = u->next = pc;
+			index[u++ - buf] = n - 1;
+			break;
+		}
+		for (i = pc; i != (int)next; i = (i + 1) & 0xFFFF)
+			incode[i] = 1;
+		if (o->mode > ABS) {
+			static int ea[] = { 0, 0, 0, EAX, EAY, EAFP, EAIND, EAINDY };
+			u->op = ea[o->mode];
+			u->a = a;
+			u->pc = pc;
+			u->next = next;
+			index[u++ - buf] = n;
+		}
+		u->op = o->mode > ABS ? o->uop + 1 : o->uop;
+		u->a = a;
+		u->pc = pc;
+		u->next = next;
+		index[u++ - buf] = n++;
+		switch (o->uop) {
+		case JMP: case JZ: case JNZ: case JN: case JC: case JNC: case JLE:
+		case JGT: case JGE: case JBE: case JA: case CALL: case RET: case HLT:
+			done = 1;
+			break;
+		}
+		pc = next;
+		if (!done && n == MAXBLOCK) {
+			u->op = END;
+			u->a = u->pc = u->next = pc;
+			index[u++ - buf] = n - 1;
+			done = 1;
+		}
+	}
+	b->n = n;
+	b->nops = u - buf;
+	b->ops = alloc(b->nops*sizeof *b->ops);
+	for (i = 0; i < b->nops; i++) {
+		b->ops[i] = buf[i];
+		b->ops[i].left = n - 1 - index[i];
+#ifdef THREADED
+		b->ops[i].label = labels[buf[i].op];
+#endif
+	}
+	b->link = blocks;
+	blocks = b;
+	nblocks++;
+	return cache[b->pc] = b;
+}
+
+/* flush - discard the decoded blocks, keeping their counts for -l */
+static void flush(void) {
+	struct block *b;
+
+	while ((b = blocks) != NULL) {
+		struct uop *u;
+		if (lineof && b->count > 0)
+			for (u = b->ops; u < b->ops + b->nops; u++)
+				if ((u->op < EAX || u->op > EAINDY) && u->op < END
+				&& lineof[u->pc] >= 0)
+					linetab[lineof[u->pc]].count += b->count;
+		cache[b->pc] = NULL;
+		blocks = b->link;
+		free(b->ops);
+		free(b);
+	}
+	memset(incode, 0, sizeof incode);
+	nflushes++;
+}
+
+/* linecmp - compare line table entries by coordinate */
+static int linecmp(const void *x, const void *y) {
+	const struct lineent *p = x, *q = y;
+	char *s = strrchr(p->coord, ':'), *t = strrchr(q->coord, ':');
+	int n = s && t ? (int)(s - p->coord) : 0, m = s && t ? (int)(t - q->coord) : 0;
+	int c = n == m ? strncmp(p->coord, q->coord, n) : strcmp(p->coord, q->coord);
+
+	if (c != 0)
+		return c;
+	return atoi(s ? s + 1 : p->coord) - atoi(t ? t + 1 : q->coord);
+}
+
+/* linecounts - print the instructions executed for each source line */
+static void linecounts(void) {
+	int i, j;
+
+	if (lineof == NULL) {
+		fprintf(stderr, "%s: no line table; compile with -Wf-lines\n", progname);
+		return;
+	}
+	flush();
+	qsort(linetab, nlinetab, sizeof *linetab, linecmp);
+	for (i = 0; i < nlinetab; i = j) {
+		unsigned long count = 0;
+		for (j = i; j < nlinetab && linecmp(&linetab[i], &linetab[j]) == 0; j++)
+			count += linetab[j].count;
+		if (count > 0)
+			printf("%12lu  %s\n", count, linetab[i].coord);
+	}
+}
+
+#define RD(a)		(mem[a] | mem[((a) + 1) & 0xFFFF]<<8)
+#define STORE(a, v)	do { unsigned a_ = (a), a1_ = (a_ + 1) & 0xFFFF; \
+	mem[a_] = (v); mem[a1_] = (v) >> 8; \
+	if (incode[a_] | incode[a1_]) { pc = u->next; *insts -= u->left; flush(); goto block; } \
+	} while (0)
+#define PUSHW(v)	do { sp = (sp - 2) & 0xFFFF; mem[sp] = (v); mem[(sp + 1) & 0xFFFF] = (v) >> 8; } while (0)
+#define POPW(v)		do { v = RD(sp); sp = (sp + 2) & 0xFFFF; } while (0)
+#define SETNZ(v)	(nz = (short)(v))
+#define ADDC(x, y, c)	do { unsigned r_ = (x) + (y) + (c); carry = r_ >> 16; ac = r_ & 0xFFFF; SETNZ(ac); } while (0)
+#define SUBB(x, y, c)	do { unsigned x_ = (x), y_ = (y) + (c); carry = x_ < y_; ac = (x_ - y_) & 0xFFFF; SETNZ(ac); } while (0)
+#define BRANCH(cond)	pc = (cond) ? u->a : u->next; goto block
+
+#ifdef THREADED
+#define CASE(x)		L_##x:
+#define DISPATCH	goto *u->label
+#else
+#define CASE(x)		case x:
+#define DISPATCH	continue
+#endif
+#define NEXT		u++; DISPATCH
+
+/*
+ * run - run the program from address 0 until HLT, or for at most limit
+ * instructions if limit is nonzero; return the exit status.  nz holds
+ * the N and Z flags as a signed value: N is nz < 0 and Z is nz == 0.
+ * CMP sets nz to the signed difference of its operands and carry to the
+ * unsigned borrow, so the signed and unsigned jumps test them directly.
+ */
+static int run(unsigned long limit, unsigned long *insts) {
+	unsigned pc = 0, ac = 0, x = 0, y = 0, sp = 0x00FF, fp = 0x00FF, ea = 0, t;
+	int nz = 0, carry = 0, c;
+	struct block *b;
+	struct uop *u;
+#ifdef THREADED
+	static void *handlers[] = {
+#define xx(x) &&L_##x,
+	UOPS
+#undef xx
+	};
+
+	labels = handlers;
+#endif
+
+block:
+	if ((b = cache[pc]) == NULL)
+		b = decode(pc);
+	b->count++;
+	*insts += b->n;
+	if (limit && *insts > limit) {
+		fprintf(stderr, "%s: stopped after %lu instructions at 0x%04x\n",
+			progname, *insts - b->n, pc);
+		*insts -= b->n;
+		b->count--;
+		return FAIL;
+	}
+	u = b->ops;
+#ifdef THREADED
+	DISPATCH;
+#else
+	for (;;)
+		switch (u->op) {
+#endif
+	CASE(LDA)	ac = RD(u->a); SETNZ(ac); NEXT;
+	CASE(LDA_E)	ac = RD(ea); SETNZ(ac); NEXT;
+	CASE(STA)	STORE(u->a, ac); NEXT;
+	CASE(STA_E)	STORE(ea, ac); NEXT;
+	CASE(ADD)	ADDC(ac, RD(u->a), 0); NEXT;
+	CASE(ADD_E)	ADDC(ac, RD(ea), 0); NEXT;
+	CASE(SUB)	SUBB(ac, RD(u->a), 0); NEXT;
+	CASE(SUB_E)	SUBB(ac, RD(ea), 0); NEXT;
+	CASE(ADC)	ADDC(ac, RD(u->a), carry); NEXT;
+	CASE(ADC_E)	ADDC(ac, RD(ea), carry); NEXT;
+	CASE(SBC)	SUBB(ac, RD(u->a), carry); NEXT;
+	CASE(SBC_E)	SUBB(ac, RD(ea), carry); NEXT;
+	CASE(AND)	ac &= RD(u->a); SETNZ(ac); NEXT;
+	CASE(AND_E)	ac &= RD(ea); SETNZ(ac); NEXT;
+	CASE(OR)	ac |= RD(u->a); SETNZ(ac); NEXT;
+	CASE(OR_E)	ac |= RD(ea); SETNZ(ac); NEXT;
+	CASE(XOR)	ac ^= RD(u->a); SETNZ(ac); NEXT;
+	CASE(XOR_E)	ac ^= RD(ea); SETNZ(ac); NEXT;
+	CASE(CMP)	t = RD(u->a); nz = (short)ac - (short)t; carry = ac < t; NEXT;
+	CASE(CMP_E)	t = RD(ea); nz = (short)ac - (short)t; carry = ac < t; NEXT;
+	CASE(PUSH_ADDR)	t = RD(u->a); PUSHW(t); NEXT;
+	CASE(PUSH_ADDR_E) t = RD(ea); PUSHW(t); NEXT;
+	CASE(POP_ADDR)	POPW(t); STORE(u->a, t); NEXT;
+	CASE(POP_ADDR_E) POPW(t); STORE(ea, t); NEXT;
+	CASE(EAX)	ea = (u->a + x) & 0xFFFF; NEXT;
+	CASE(EAY)	ea = (u->a + y) & 0xFFFF; NEXT;
+	CASE(EAFP)	ea = (u->a + fp) & 0xFFFF; NEXT;
+	CASE(EAIND)	ea = RD(u->a); NEXT;
+	CASE(EAINDY)	ea = (RD(u->a) + y) & 0xFFFF; NEXT;
+	CASE(LDI)	ac = u->a; SETNZ(ac); NEXT;
+	CASE(LDXI)	x = u->a; SETNZ(x); NEXT;
+	CASE(LDYI)	y = u->a; SETNZ(y); NEXT;
+	CASE(CMPI)	nz = (short)ac - (short)u->a; carry = ac < u->a; NEXT;
+	CASE(MULI)	t = ac*u->a; ac = t & 0xFFFF; y = t >> 16; SETNZ(ac); NEXT;
+	CASE(DIVI)	t = u->a; goto divide;
+	CASE(IN)	if (inport[u->a & 0xFF] == NULL)
+				ac = 0;
+			else if ((c = getc(inport[u->a & 0xFF])) == EOF)
+				ac = 0xFFFF;
+			else
+				ac = c;
+			SETNZ(ac); NEXT;
+	CASE(OUT)	if (outport[u->a & 0xFF])
+				putc(ac & 0xFF, outport[u->a & 0xFF]);
+			NEXT;
+	CASE(TAX)	x = ac; SETNZ(x); NEXT;
+	CASE(TXA)	ac = x; SETNZ(ac); NEXT;
+	CASE(TAY)	y = ac; SETNZ(y); NEXT;
+	CASE(TYA)	ac = y; SETNZ(ac); NEXT;
+	CASE(SWPX)	t = ac; ac = x; x = t; SETNZ(ac); NEXT;
+	CASE(SWPY)	t = ac; ac = y; y = t; SETNZ(ac); NEXT;
+	CASE(INX)	x = (x + 1) & 0xFFFF; SETNZ(x); NEXT;
+	CASE(INY)	y = (y + 1) & 0xFFFF; SETNZ(y); NEXT;
+	CASE(DEX)	x = (x - 1) & 0xFFFF; SETNZ(x); NEXT;
+	CASE(DEY)	y = (y - 1) & 0xFFFF; SETNZ(y); NEXT;
+	CASE(INC)	ac = (ac + 1) & 0xFFFF; SETNZ(ac); NEXT;
+	CASE(DEC)	ac = (ac - 1) & 0xFFFF; SETNZ(ac); NEXT;
+	CASE(NEG)	ac = -ac & 0xFFFF; SETNZ(ac); NEXT;
+	CASE(NOT)	ac = ~ac & 0xFFFF; SETNZ(ac); NEXT;
+	CASE(SHL)	carry = ac >> 15; ac = (ac << 1) & 0xFFFF; SETNZ(ac); NEXT;
+	CASE(SHR)	carry = ac & 1; ac >>= 1; SETNZ(ac); NEXT;
+	CASE(ASR)	carry = ac & 1; ac = (ac >> 1) | (ac & 0x8000); SETNZ(ac); NEXT;
+	CASE(ADDX)	ADDC(ac, x, 0); NEXT;
+	CASE(SUBX)	SUBB(ac, x, 0); NEXT;
+	CASE(ANDX)	ac &= x; SETNZ(ac); NEXT;
+	CASE(ORX)	ac |= x; SETNZ(ac); NEXT;
+	CASE(XORX)	ac ^= x; SETNZ(ac); NEXT;
+	CASE(MUL)	t = ac*x; ac = t & 0xFFFF; y = t >> 16; SETNZ(ac); NEXT;
+	CASE(DIV)	t = x;
+	divide:		if (t == 0) {
+				fprintf(stderr, "%s: division by zero at 0x%04x\n", progname, u->pc);
+				return 1;
+			}
+			y = ((short)ac % (short)t) & 0xFFFF;
+			ac = ((short)ac / (short)t) & 0xFFFF;
+			SETNZ(ac); NEXT;
+	CASE(MOD)	if (x == 0) {
+				fprintf(stderr, "%s: division by zero at 0x%04x\n", progname, u->pc);
+				return 1;
+			}
+			ac = ((short)ac % (short)x) & 0xFFFF;
+			SETNZ(ac); NEXT;
+	CASE(PUSH)	PUSHW(ac); NEXT;
+	CASE(POP)	POPW(ac); NEXT;
+	CASE(PUSH_FP)	PUSHW(fp); NEXT;
+	CASE(POP_FP)	POPW(fp); NEXT;
+	CASE(TSF)	fp = sp; NEXT;
+	CASE(TFS)	sp = fp; NEXT;
+	CASE(NOP)	NEXT;
+	CASE(JMP)	pc = u->a; goto block;
+	CASE(JZ)	BRANCH(nz == 0);
+	CASE(JNZ)	BRANCH(nz != 0);
+	CASE(JN)	BRANCH(nz < 0);
+	CASE(JC)	BRANCH(carry);
+	CASE(JNC)	BRANCH(!carry);
+	CASE(JLE)	BRANCH(nz <= 0);
+	CASE(JGT)	BRANCH(nz > 0);
+	CASE(JGE)	BRANCH(nz >= 0);
+	CASE(JBE)	BRANCH(carry || nz == 0);
+	CASE(JA)	BRANCH(!carry && nz != 0);
+	CASE(CALL)	PUSHW(u->next); pc = u->a; goto block;
+	CASE(RET)	POPW(pc); goto block;
+	CASE(HLT)	return ac & 0xFF;
+	CASE(END)	pc = u->a; goto block;
+	CASE(ILLEGAL)	fprintf(stderr, "%s: illegal instruction 0x%02x at 0x%04x\n",
+				progname, mem[u->pc], u->pc);
+			return 1;
+#ifndef THREADED
+		}
+#endif
+}
@@ -0,0 +1,222 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* nxtrace [ -a address ] [ -r address ] [ -w size ] dump
+ * print the call trace in the -tring=N buffer of a memory dump
+ *
+ * rcc -tring=N records each function entry and return in _tracebuf,
+ * which the unit that defines main lays out as
+ *
+ *	magic (0x5452), N, words per record, position, N records
+ *
+ * all in unsigned words.  A record holds the address of a descriptor
+ * string, the function's frame number and the values the descriptor
+ * names: "call f a:i b:p" or "return f u".  The codes are c and C for
+ * signed and unsigned char, i and u for int and unsigned, p for
+ * pointers, wN for N raw words, and ? for values not recorded.  The
+ * position is the byte offset of the next record to write, so the
+ * oldest record follows it.  nxtrace finds the buffer in the dump (raw
+ * little-endian memory starting at address 0 or -a address), or at -r
+ * address, and prints the records oldest first in the form -t uses.
+ */
+
+static char rcsid[] = "$Id$";
+
+#define RINGMAGIC 0x5452
+
+char *progname;
+static unsigned char *mem;		/* dump of addresses base..base+size-1 */
+static unsigned long base, size;
+static int wordsize = 2;		/* bytes per unsigned word */
+
+void *alloc(unsigned);
+static unsigned long word(unsigned long);
+static char *descriptor(unsigned long);
+static unsigned long findring(void);
+static void printrecord(unsigned long);
+
+int main(int argc, char *argv[]) {
+	unsigned long ring = 0, n, words, pos, recsize, i;
+	int c, findit = 1;
+	FILE *fp;
+
+	progname = argv[0];
+	for (c = 1; c < argc && *argv[c] == '-'; c++)
+		if (strcmp(argv[c], "-a") == 0 && c + 1 < argc)
+			base = strtoul(argv[++c], NULL, 0);
+		else if (strcmp(argv[c], "-r") == 0 && c + 1 < argc) {
+			ring = strtoul(argv[++c], NULL, 0);
+			findit = 0;
+		} else if (strcmp(argv[c], "-w") == 0 && c + 1 < argc)
+			wordsize = atoi(argv[++c]);
+		else
+			break;
+	if (c != argc - 1 || (wordsize != 2 && wordsize != 4)) {
+		fprintf(stderr, "usage: %s [ -a address ] [ -r address ] [ -w 2|4 ] dump\n", progname);
+		exit(1);
+	}
+	if ((fp = fopen(argv[c], "rb")) == NULL) {
+		fprintf(stderr, "%s: can't read `%s'\n", progname, argv[c]);
+		exit(1);
+	}
+	fseek(fp, 0L, SEEK_END);
+	size = ftell(fp);
+	rewind(fp);
+	mem = alloc(size ? size : 1);
+	if (fread(mem, 1, size, fp) != size) {
+		fprintf(stderr, "%s: error reading `%s'\n", progname, argv[c]);
+		exit(1);
+	}
+	fclose(fp);
+	if (findit && (ring = findring()) == 0) {
+		fprintf(stderr, "%s: no -tring buffer in `%s'\n", progname, argv[c]);
+		exit(1);
+	}
+	if (word(ring) != RINGMAGIC) {
+		fprintf(stderr, "%s: no -tring buffer at 0x%lx\n", progname, ring);
+		exit(1);
+	}
+	n = word(ring + wordsize);
+	words = word(ring + 2*wordsize);
+	recsize = words*wordsize;
+	pos = word(ring + 3*wordsize)/recsize;
+	for (i = 0; i < n; i++)
+		printrecord(ring + 4*wordsize + ((pos + i)%n)*recsize);
+	return 0;
+}
+
+/* alloc - allocate n bytes or die */
+void *alloc(unsigned n) {
+	void *new = malloc(n);
+
+	if (new == NULL) {
+		fprintf(stderr, "%s: out of memory\n", progname);
+		exit(1);
+	}
+	return new;
+}
+
+/* word - return the word at addr */
+static unsigned long word(unsigned long addr) {
+	unsigned long w = 0;
+	int i;
+
+	if (addr < base || addr + wordsize > base + size) {
+		fprintf(stderr, "%s: address 0x%lx is not in the dump\n", progname, addr);
+		exit(1);
+	}
+	for (i = wordsize - 1; i >= 0; i--)
+		w = w<<8 | mem[addr - base + i];
+	return w;
+}
+
+/* descriptor - return the string at addr, or NULL */
+static char *descriptor(unsigned long addr) {
+	unsigned long a;
+
+	if (addr < base)
+		return NULL;
+	for (a = addr; a < base + size; a++)
+		if (mem[a - base] == 0)
+			return (char *)&mem[addr - base];
+	return NULL;
+}
+
+/* findring - return the address of the first plausible ring buffer, or 0 */
+static unsigned long findring(void) {
+	unsigned long a, n;
+
+	for (a = base; a + 4*wordsize <= base + size; a++)
+		if (word(a) == RINGMAGIC && word(a + 2*wordsize) > 2
+		&& (n = word(a + wordsize)) > 0 && (n&(n - 1)) == 0
+		&& a + (4 + n*word(a + 2*wordsize))*wordsize <= base + size)
+			return a;
+	return 0;
+}
+
+/* printvalue - print the value with code s in the words at *addr, advance *addr, and return the code's end */
+static char *printvalue(char *s, unsigned long *addr) {
+	unsigned long w;
+	int n;
+
+	switch (*s) {
+	case 'c': case 'i':
+		w = word(*addr);
+		*addr += wordsize;
+		if (w >> (8*wordsize - 1))
+			printf("-%lu", ((~w) & (wordsize == 2 ? 0xFFFFUL : 0xFFFFFFFFUL)) + 1);
+		else
+			printf("%lu", w);
+		break;
+	case 'C': case 'u':
+		printf("%lu", word(*addr));
+		*addr += wordsize;
+		break;
+	case 'p':
+		printf("0x%lx", word(*addr));
+		*addr += wordsize;
+		break;
+	case 'w':
+		n = s[1] - '0';
+		printf("0x");
+		while (--n >= 0)
+			printf(wordsize == 2 ? "%04lx" : "%08lx", word(*addr + n*wordsize));
+		*addr += (s[1] - '0')*wordsize;
+		s++;
+		break;
+	default:
+		printf("?");
+		break;
+	}
+	return *s ? s + 1 : s;
+}
+
+/* printrecord - print the record at addr, if it is in use */
+static void printrecord(unsigned long addr) {
+	unsigned long frame, desc = word(addr);
+	char *s, *t;
+	int first = 1;
+
+	if (desc == 0)
+		return;
+	frame = word(addr + wordsize);
+	addr += 2*wordsize;
+	if ((s = descriptor(desc)) == NULL
+	|| (strncmp(s, "call ", 5) != 0 && strncmp(s, "return ", 7) != 0)) {
+		printf("? (bad record)\n");
+		return;
+	}
+	t = strchr(s, ' ') + 1;
+	for ( ; *t && *t != ' '; t++)
+		putchar(*t);
+	printf("#%lu", frame);
+	if (*s == 'r') {
+		printf(" returned");
+		if (*t == ' ') {
+			putchar(' ');
+			printvalue(t + 1, &addr);
+		}
+		printf("\n");
+		return;
+	}
+	putchar('(');
+	while (*t == ' ') {
+		t++;
+		if (!first)
+			putchar(',');
+		first = 0;
+		if (strncmp(t, "...", 3) == 0) {
+			printf("...");
+			break;
+		}
+		for ( ; *t && *t != ':'; t++)
+			putchar(*t);
+		if (*t == ':') {
+			putchar('=');
+			t = printvalue(t + 1, &addr);
+		}
+	}
+	printf(") called\n");
+}
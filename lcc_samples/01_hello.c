@@ -1,6 +1,9 @@
 /*
  * 01_hello.c - Simple return value test
  * Tests: Basic function, 16-bit constant return
+ * Expected result: returns 42
+ * Run with:
+ * Run with: -frames=static
  */
 
 int main(void) {
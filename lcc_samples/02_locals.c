@@ -1,6 +1,9 @@
 /*
  * 02_locals.c - Local variable test
  * Tests: Local variable allocation, assignment, 16-bit values
+ * Expected result: returns 44
+ * Run with:
+ * Run with: -frames=static
  */
 
 int main(void) {
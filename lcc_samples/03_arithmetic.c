@@ -1,6 +1,9 @@
 /*
  * 03_arithmetic.c - Arithmetic operations test
  * Tests: 16-bit addition, subtraction, multiplication, division
+ * Expected result: returns 100
+ * Run with:
+ * Run with: -frames=static
  */
 
 int add(int a, int b) {
@@ -1,6 +1,9 @@
 /*
  * 04_globals.c - Global variable test
  * Tests: Global variable declaration, access, modification
+ * Expected result: returns 15
+ * Run with:
+ * Run with: -frames=static
  */
 
 int counter;
@@ -1,6 +1,9 @@
 /*
  * 05_loop.c - Loop and comparison test
  * Tests: While loop, 16-bit comparison, increment
+ * Expected result: returns 55
+ * Run with:
+ * Run with: -frames=static
  */
 
 int sum_to_n(int n) {
@@ -1,6 +1,9 @@
 /*
  * 06_array.c - Array test
  * Tests: Global array, indexed access, 16-bit elements
+ * Expected result: returns 150
+ * Run with:
+ * Run with: -frames=static
  */
 
 int data[5];
@@ -1,6 +1,9 @@
 /*
  * 07_factorial.c - Iterative factorial
  * Tests: Loop, multiplication, comparison
+ * Expected result: returns 120
+ * Run with:
+ * Run with: -frames=static
  */
 
 int factorial(int n) {
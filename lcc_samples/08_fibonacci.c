@@ -1,6 +1,10 @@
 /*
  * 08_fibonacci.c - Fibonacci sequence
  * Tests: Recursion, multiple function calls, comparison
+ * Expected result: returns 55
+ * Run with:
+ * Run with: -frames=static
+ * Run with: -b
  */
 
 int fib(int n) {
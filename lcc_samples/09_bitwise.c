@@ -1,6 +1,9 @@
 /*
  * 09_bitwise.c - Bitwise operations test
  * Tests: AND, OR, XOR on 16-bit values
+ * Expected result: returns 254
+ * Run with:
+ * Run with: -frames=static
  */
 
 int and_op(int a, int b) {
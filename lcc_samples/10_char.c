@@ -1,6 +1,9 @@
 /*
  * 10_char.c - Character (8-bit) operations
  * Tests: 8-bit char type, promotion to int
+ * Expected result: returns 145
+ * Run with:
+ * Run with: -frames=static
  */
 
 char to_upper(char c) {
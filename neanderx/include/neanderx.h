@@ -39,9 +39,17 @@ typedef unsigned char bool;
 #define IO_PORT0  0x00
 #define IO_PORT1  0x01
 
-/* Memory-mapped I/O macros */
-#define INPUT()       __input(0)
-#define OUTPUT(val)   __output(0, val)
+/*
+ * Port I/O intrinsics: the compiler emits a single IN/OUT instruction
+ * instead of a call.  The port number must be a constant.
+ */
+int  __builtin_in(int port);
+void __builtin_out(int port, int val);
+
+#define INPUT()            __builtin_in(IO_PORT0)
+#define OUTPUT(val)        __builtin_out(IO_PORT0, val)
+#define PORT_IN(port)      __builtin_in(port)
+#define PORT_OUT(port, v)  __builtin_out(port, v)
 
 /* Inline assembly helpers (not directly supported, use asm comments) */
 #define NOP()         /* NOP */
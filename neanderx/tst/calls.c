@@ -0,0 +1,30 @@
+/*
+ * Callers pop the arguments they push, so a loop can make more calls
+ * than the stack has bytes.  The counters are globals.
+ * Expected result: returns 42
+ * Run with:
+ * Run with: -regparm=1
+ * Run with: -b
+ * Run with: -clone
+ * Run with: -tring=16
+ * Run with: -frames=static -clone
+ */
+
+int g, n;
+
+void add(int a) {
+    g = g + a;
+}
+
+long add2(int a, int b) {
+    g = g + b;
+    return 0L;
+}
+
+int main(void) {
+    for (n = 0; n < 300; n++)
+        add(1);
+    for (n = 0; n < 200; n++)
+        add2(1, 2);
+    return g - 658;
+}
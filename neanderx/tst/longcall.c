@@ -0,0 +1,42 @@
+/*
+ * 32-bit results of direct and indirect calls: stored, assigned
+ * through a temporary and returned.  70002 is 0x11172.
+ * Expected result: returns 42
+ * Run with:
+ * Run with: -regparm=2
+ * Run with: -tring=16
+ */
+
+long lv = 70002L;
+int seen;
+
+long lf(int a) {
+    seen = seen + a;
+    return lv;
+}
+
+long (*fp)(int) = lf;
+long gx, gy, gz;
+
+long g(void) {
+    return fp(3);
+}
+
+int main(void) {
+    int *p;
+
+    fp(1);
+    gx = fp(2);
+    gy = g();
+    gz = lf(0);
+    p = (int *)&gx;
+    if (p[0] != 4466 || p[1] != 1)
+        return 1;
+    p = (int *)&gy;
+    if (p[0] != 4466 || p[1] != 1)
+        return 2;
+    p = (int *)&gz;
+    if (p[0] != 4466 || p[1] != 1)
+        return 3;
+    return seen + 36;
+}
@@ -0,0 +1,77 @@
+/*
+ * Fill, copy and length loops, which become calls to the runtime's
+ * _fillb, _fillw, _copyb, _copyw and _lenb, with their edge cases.
+ * do-while loops run their body before the test and stay loops.
+ * Expected result: returns 100
+ * Run with:
+ * Run with: -frames=static
+ * Run with: -fcache
+ * Run with: -frames=static -hotdata=8
+ */
+
+char ca[21], cb[21];
+int ia[11], ib[11];
+
+void fillc(void) { int i; for (i = 0; i < 20; i++) ca[i] = 3; }
+void filli(int n) { int i; for (i = 0; i < n; i++) ia[i] = 7; }
+void copyc(char *d, char *s, int n) { int i; for (i = 0; i < n; i++) d[i] = s[i]; }
+int len(char *s) { int i; for (i = 0; s[i]; i++) ; return i; }
+void fillv(int *d, int n, int v) { int i; for (i = 0; i < n; i++) d[i] = v; }
+void fillcv(char *d, int n, int c) { int i; for (i = 0; i < n; i++) d[i] = c; }
+int fillfrom(char *d, int n) { int i; for (i = 2; i < n; i++) d[i] = 'x'; return i; }
+int copyi(int *d, int *s) { int i; for (i = 0; i < 10; i++) d[i] = s[i]; return i; }
+int dofill(int k, int end) { do { ia[k] = 5; k++; } while (k < end); return k; }
+int dolen(char *s) { int k = 0; do k++; while (s[k]); return k; }
+
+int main(void) {
+    ca[20] = 9;
+    fillc();
+    if ((ca[0] & 255) != 3 || (ca[19] & 255) != 3 || (ca[20] & 255) != 9)
+        return 1;
+    ia[5] = 9;
+    filli(5);
+    if (ia[0] != 7 || ia[4] != 7 || ia[5] != 9)
+        return 2;
+    ia[0] = 9;
+    filli(0);
+    filli(-3);
+    if (ia[0] != 9)
+        return 3;
+    cb[0] = 1; cb[1] = 2; cb[2] = 3; cb[3] = 4; cb[4] = 5;
+    copyc(ca, cb, 5);
+    if ((ca[0] & 255) != 1 || (ca[3] & 255) != 4 || (ca[4] & 255) != 5)
+        return 4;
+    cb[0] = 1; cb[1] = 2; cb[2] = 3; cb[3] = 4;
+    copyc(cb + 1, cb, 3);
+    if ((cb[1] & 255) != 1 || (cb[3] & 255) != 1)
+        return 10;
+    ca[0] = 'a'; ca[1] = 'b'; ca[2] = 'c'; ca[3] = 0;
+    if (len(ca) != 3 || len(ca + 3) != 0)
+        return 5;
+    ib[7] = 5;
+    fillv(ib, 7, -2);
+    if (ib[0] != -2 || ib[6] != -2 || ib[7] != 5)
+        return 6;
+    cb[3] = 0;
+    fillcv(cb, 3, 300);
+    if ((cb[0] & 255) != 44 || (cb[2] & 255) != 44 || (cb[3] & 255) != 0)
+        return 7;
+    cb[6] = 1; cb[1] = 1;
+    if (fillfrom(cb, 6) != 6 || (cb[1] & 255) != 1 || (cb[2] & 255) != 120
+    || (cb[5] & 255) != 120 || (cb[6] & 255) != 1)
+        return 8;
+    ib[0] = 2; ib[9] = 9;
+    if (copyi(ia, ib) != 10 || ia[0] != 2 || ia[9] != 9)
+        return 9;
+    ia[0] = ia[1] = ia[3] = ia[6] = 0;
+    if (dofill(0, 0) != 1 || ia[0] != 5 || ia[1] != 0)
+        return 11;
+    if (dofill(2, 1) != 3 || ia[2] != 5 || ia[3] != 0)
+        return 12;
+    if (dofill(3, 6) != 6 || ia[3] != 5 || ia[5] != 5 || ia[6] != 0)
+        return 13;
+    ca[0] = 'a'; ca[1] = 'b'; ca[2] = 'c'; ca[3] = 0;
+    if (dolen(ca) != 3 || dolen(ca + 2) != 1)
+        return 14;
+    return 100;
+}
@@ -0,0 +1,70 @@
+/*
+ * Pointer variables dereferenced through (addr) and (addr),Y: struct
+ * fields, a linked list, and *p++ walks such as a string copy.
+ * Expected result: returns 100
+ * Run with:
+ * Run with: -regparm=2
+ * Run with: -b
+ * Run with: -fcache
+ * Run with: -hotdata=8
+ * Run with: -frames=static
+ */
+
+struct node {
+    int val;
+    int pad;
+    struct node *next;
+};
+
+struct node n1, n2, n3;
+char src[8], dst[8];
+int ia[4];
+
+int sum(struct node *p) {
+    int s;
+
+    s = 0;
+    while (p) {
+        s = s + p->val;
+        p = p->next;
+    }
+    return s;
+}
+
+void setpad(struct node *p, int v) {
+    p->pad = v;
+}
+
+void copy(char *d, char *s) {
+    while (*d++ = *s++)
+        ;
+}
+
+int total(int *p, int n) {
+    int s;
+
+    s = 0;
+    while (n-- > 0)
+        s = s + *p++;
+    return s;
+}
+
+int main(void) {
+    n1.val = 10; n1.next = &n2;
+    n2.val = 20; n2.next = &n3;
+    n3.val = 30; n3.next = 0;
+    if (sum(&n1) != 60 || sum(&n3) != 30)
+        return 1;
+    setpad(&n2, 7);
+    if (n2.pad != 7 || n2.val != 20 || n1.pad != 0)
+        return 2;
+    src[0] = 'h'; src[1] = 'i'; src[2] = '!'; src[3] = 0;
+    dst[3] = 5;
+    copy(dst, src);
+    if ((dst[0] & 255) != 'h' || (dst[2] & 255) != '!' || (dst[3] & 255) != 0)
+        return 3;
+    ia[0] = 1; ia[1] = 2; ia[2] = 3; ia[3] = 4;
+    if (total(ia, 4) != 10 || total(ia + 1, 2) != 5)
+        return 4;
+    return 100;
+}
@@ -0,0 +1,17 @@
+/*
+ * I/O port intrinsics: constant ports become IN and OUT.  Unbound
+ * ports read 0 and discard what is written.
+ * Expected result: returns 5
+ */
+
+int  __builtin_in(int port);
+void __builtin_out(int port, int val);
+
+int poll(void) {
+    __builtin_out(3, 65);
+    return __builtin_in(3);
+}
+
+int main(void) {
+    return poll() + 5;
+}
@@ -0,0 +1,25 @@
+/*
+ * -b counts: sq runs 10 times, its then part 4 times.  The counters
+ * are globals.
+ * Expected result: returns 42
+ * Run with: -b
+ * Run with: -b -fcache
+ */
+
+int n, s, odd, t, r;
+
+int sq(int x) {
+    if (x > 5)
+        odd = odd + 1;
+    else
+        s = s + 1;
+    return x + x;
+}
+
+int main(void) {
+    for (n = 0; n < 10; n++) {
+        r = sq(n);
+        t = t + r;
+    }
+    return t - 58 + s + odd;
+}
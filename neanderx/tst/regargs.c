@@ -0,0 +1,35 @@
+/*
+ * Register arguments (-Wf-regparm=N): direct calls with the second
+ * argument moved by TAX or popped into X through Y, and an indirect
+ * call through _icarg and _icall.  A direct call to a function whose
+ * address is also taken reads it from a temporary and stays direct.
+ * Expected result: returns 30
+ * Run with:
+ * Run with: -regparm=1
+ * Run with: -regparm=2
+ * Run with: -regparm=2 -clone
+ */
+
+int x = 7;
+
+int sub(int a, int b) {
+    return a - b;
+}
+
+int twice(int a, int b) {
+    return a + a - b;
+}
+
+int (*fp)(int, int) = twice;
+int (*gp)(int, int);
+
+int main(void) {
+    int r;
+
+    r = sub(x + 1, 3);      /* 5: the first argument needs X */
+    r = r + sub(9, 2);      /* 12 */
+    gp = sub;
+    r = r + sub(10, 3);     /* 19 */
+    r = r + fp(5, 1);       /* 28 */
+    return r + gp(4, 2);    /* 30 */
+}
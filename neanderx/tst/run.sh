@@ -0,0 +1,70 @@
+#!/bin/sh
+# $Id$
+# run neanderx/tst/foo.c
+#
+# Preprocess foo.c with cpp, as lcc does, so -b points carry the file
+# name; compile it with rcc -target=neanderx once for each "Run with:" line
+# in its comment (once with no options if there is none), link it with
+# nxld, run it under nxsim and compare the exit status with its
+# "Expected result: returns N" line (99 means nxsim itself failed).
+# With -b, nxprof turns the counters into prof.out, which must match
+# foo.prof.  A bare -fcache compiles twice into an empty cache in
+# $TSTDIR/fcache, and the warm compilation must match the cold one.
+
+# set -x
+BUILDDIR=${BUILDDIR-.}
+TSTDIR=${TSTDIR-${BUILDDIR}/neanderx/tst}
+if [ ! -d $TSTDIR ]; then mkdir -p $TSTDIR; fi
+
+C=`basename $1 .c`
+dir=`dirname $1`
+expect=`sed -n 's/.*Expected result: returns \([0-9]*\).*/\1/p' $1 | sed 1q`
+if [ -z "$expect" ]; then
+	echo 1>&2 $0: $1: no '"Expected result: returns N"' line
+	exit 1
+fi
+runs=`sed -n 's/.*Run with:\(.*\)$/\1/p' $1 |
+	sed 's/^ *//; s/ *$//; s/^$/-/; s/ /,/g'`
+status=0
+if ! ${BUILDDIR}/cpp -I${dir}/../include $1 >$TSTDIR/$C.i; then
+	exit 1
+fi
+for opts in ${runs:--}; do
+	opts=`echo "$opts" | sed 's/^-$//; s/,/ /g'`
+	echo ${BUILDDIR}/rcc -target=neanderx $opts $1: 1>&2
+	rm -f $TSTDIR/$C.s $TSTDIR/$C.ld.s $TSTDIR/$C.mem $TSTDIR/prof.out
+	warm=
+	case " $opts " in
+	*" -fcache "*)
+		rm -rf $TSTDIR/fcache
+		mkdir $TSTDIR/fcache
+		opts=`echo " $opts " | sed "s| -fcache | -fcache=$TSTDIR/fcache |"`
+		warm=$TSTDIR/$C.warm.s ;;
+	esac
+	if ! ${BUILDDIR}/rcc -target=neanderx $opts $TSTDIR/$C.i $TSTDIR/$C.s ||
+	   ! ${BUILDDIR}/nxld -o $TSTDIR/$C.ld.s $TSTDIR/$C.s; then
+		status=1
+		continue
+	fi
+	if [ -n "$warm" ] &&
+	   ! { ${BUILDDIR}/rcc -target=neanderx $opts $TSTDIR/$C.i $warm &&
+	       cmp -s $TSTDIR/$C.s $warm; }; then
+		echo 1>&2 $0: $1 $opts: warm -fcache output differs
+		status=1
+	fi
+	${BUILDDIR}/nxsim -n 10000000 -d $TSTDIR/$C.mem $TSTDIR/$C.ld.s
+	got=$?
+	if [ "$got" = 99 ]; then
+		echo 1>&2 $0: $1 $opts: nxsim failed
+		status=1
+	elif [ "$got" != "$expect" ]; then
+		echo 1>&2 $0: $1 $opts: returned $got, expected $expect
+		status=1
+	fi
+	case " $opts " in
+	*" -b "*)
+		${BUILDDIR}/nxprof -o $TSTDIR/prof.out $TSTDIR/$C.ld.s $TSTDIR/$C.mem &&
+		sed "s|$dir/||g" $TSTDIR/prof.out | diff $dir/$C.prof - || status=1 ;;
+	esac
+done
+exit $status
@@ -0,0 +1,27 @@
+/*
+ * Startup code: .bss and .data of odd sizes, which nxld pads to a word,
+ * and a -hotdata block, which _start clears with the stack page.
+ * Expected result: returns 42
+ * Run with:
+ * Run with: -hotdata=4
+ * Run with: -tring=16
+ */
+
+char c;
+int n = 0;
+char d = 5;
+int hot;
+
+int main(void) {
+    int i;
+
+    for (i = 0; i < 3; i++)
+        hot++;
+    if (c)
+        return 1;
+    if (n)
+        return 2;
+    if (d != 5)
+        return 3;
+    return hot + 39;
+}
@@ -1,7 +1,9 @@
 #include "c.h"
 #undef yy
 #define yy \
+xx(bytecode,     bytecodeIR) \
 xx(neanderx,     neanderxIR) \
+xx(symbolic,     symbolicIR) \
 xx(null,         nullIR)
 
 #undef xx
@@ -142,8 +142,11 @@ static void dumptree(Node p) {
 }
 
 static void I(emit)(Node p) {
-	for (; p; p = p->link)
+	for (; p; p = p->link) {
 		dumptree(p);
+		if (generic(p->op) == CALL && optype(p->op) != V)
+			print("pop\n");	/* discard the unused result */
+	}
 }
 
 static void I(export)(Symbol p) {
@@ -156,10 +159,9 @@ static void I(function)(Symbol f, Symbol caller[], Symbol callee[], int ncalls)
 	(*IR->segment)(CODE);
 	offset = 0;
 	for (i = 0; caller[i] && callee[i]; i++) {
-		offset = roundup(offset, caller[i]->type->align);
 		caller[i]->x.name = callee[i]->x.name = stringf("%d", offset);
 		caller[i]->x.offset = callee[i]->x.offset = offset;
-		offset += caller[i]->type->size;
+		offset += caller[i]->type->size < 4 ? 4 : caller[i]->type->size;	/* as gen02 lays out ARGs */
 	}
 	maxargoffset = maxoffset = argoffset = offset = 0;
 	gencode(caller, callee);
@@ -213,7 +215,16 @@ static void I(local)(Symbol p) {
 	offset += p->type->size;
 }
 
-static void I(progbeg)(int argc, char *argv[]) {}
+static void I(progbeg)(int argc, char *argv[]) {
+	union {
+		char c;
+		int i;
+	} u;
+
+	u.i = 0;
+	u.c = 1;
+	swap = ((int)(u.i == 1)) != IR->little_endian;
+}
 
 static void I(progend)(void) {}
 
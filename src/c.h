@@ -228,6 +228,7 @@ struct code {
 		struct {
 			Coordinate src;
 			int point;
+			int count;	/* execution count from prof.out, or -1 */
 		} point; 
 		Node forest;
 		struct {
@@ -378,6 +379,7 @@ extern int xref;
 
 extern int ncalled;
 extern int npoints;
+extern Symbol YYcounts;
 
 extern int needconst;
 extern int explicitCast;
@@ -508,6 +510,17 @@ extern int main(int, char *[]);
 
 extern void vfprint(FILE *, char *, const char *, va_list);
 
+extern char *fcachedir;
+extern int fcachebegin(Symbol, Symbol [], Symbol [], int, int [], int);
+extern void fcacheend(int [], int);
+extern void fcacheinit(int, char *[], char *);
+
+extern char *optionstring(int, char *[]);
+extern char *pchfile;
+extern void pchcheckpoint(void);
+extern void pchload(void);
+extern int pchopen(int, char *[]);
+
 void profInit(char *);
 extern int process(char *);
 extern int findfunc(char *, char *);
@@ -595,6 +608,7 @@ extern Type promote(Type);
 extern Type ptr(Type);
 extern Type qual(int, Type);
 extern void rmtypes(int);
+extern Type typenode(int, Type, int, int, void *);
 extern int ttob(Type);
 extern int variadic(Type);
 
@@ -34,7 +34,9 @@ void program(void) {
 	int n;
 	
 	level = GLOBAL;
-	for (n = 0; t != EOI; n++)
+	for (n = 0; t != EOI; n++) {
+		if (pchfile)
+			pchcheckpoint();
 		if (kind[t] == CHAR || kind[t] == STATIC
 		|| t == ID || t == '*' || t == '(') {
 			decl(dclglobal);
@@ -48,6 +50,7 @@ void program(void) {
 			error("unrecognized declaration\n");
 			t = gettok();
 		}
+	}
 	if (n == 0)
 		warning("empty input file\n");
 }
@@ -0,0 +1,359 @@
+#include "c.h"
+#include <ctype.h>
+
+static char rcsid[] = "$Id$";
+
+/*
+ * -fcache=dir: per-function code cache.
+ *
+ * A back end calls fcachebegin just before it generates code for a
+ * function.  fcachebegin hashes the function's Code list, its
+ * parameters, the target and the options; if dir holds the text
+ * emitted for that hash, fcachebegin copies it to the output and
+ * the back end skips labeling, allocation and emission.  Otherwise
+ * the back end generates the function as usual and fcacheend saves
+ * what it emitted.
+ *
+ * Generated labels are numbered in order of appearance within the
+ * function, so an edit that shifts the label numbers of a function
+ * does not invalidate it; the saved text is relocated to the
+ * current numbers.  The output is read back from outfile, so the
+ * cache is used only when rcc writes a named file.
+ */
+
+#define RELOC '\001'		/* RELOC n RELOC: the n'th generated label */
+
+char *fcachedir;		/* -fcache=dir, if non-NULL */
+
+static char *outname;		/* output file */
+static char *options;		/* options the text depends on */
+static unsigned long h0, h1;	/* hash of the current function */
+static long start;		/* output offset of its text */
+static int capturing;
+
+static struct hent {		/* pointer or label number -> ordinal */
+	unsigned long key;
+	int kind, n;
+	struct hent *link;
+} **htab;
+static int nsyms, nnodes;
+static int *labelv;		/* labelv[n]: number of the n'th generated label */
+static int nlabels, maxlabels;
+static int clash;		/* a fixed name looks like a generated label */
+
+/* fcacheinit - note the options and the output file; called from main_init */
+void fcacheinit(int argc, char *argv[], char *outfile) {
+	if (outfile == NULL || strcmp(outfile, "-") == 0) {
+		warning("-fcache needs an output file\n");
+		fcachedir = NULL;
+		return;
+	}
+	outname = outfile;
+	options = optionstring(argc, argv);
+}
+
+static struct hent *hlookup(unsigned long key, int kind, int add) {
+	unsigned h = (key>>3^key^kind)&255;
+	struct hent *q;
+
+	for (q = htab[h]; q; q = q->link)
+		if (q->key == key && q->kind == kind)
+			return q;
+	if (!add)
+		return NULL;
+	NEW0(q, FUNC);
+	q->key = key;
+	q->kind = kind;
+	q->link = htab[h];
+	htab[h] = q;
+	return q;
+}
+
+static void hbytes(const void *p, int n) {
+	const unsigned char *s = p;
+
+	while (--n >= 0) {
+		h0 = ((h0^*s)*16777619UL)&0xffffffffUL;
+		h1 = (h1*31 + *s++ + (h1>>27))&0xffffffffUL;
+	}
+}
+
+static void hint(long n) {
+	hbytes(&n, sizeof n);
+}
+
+static void hstr(const char *s) {
+	if (s)
+		hbytes(s, strlen(s) + 1);
+	else
+		hint(-1);
+}
+
+/* labelnum - n if s is _Ln followed by a non-digit, else -1 */
+static int labelnum(const char *s, const char **rest) {
+	int n = 0;
+
+	if (s == NULL || s[0] != '_' || s[1] != 'L' || !isdigit(s[2]))
+		return -1;
+	for (s += 2; isdigit(*s); s++)
+		n = 10*n + *s - '0';
+	if (rest)
+		*rest = s;
+	return isalpha(*s) || *s == '_' ? -1 : n;
+}
+
+static void hname(Symbol p) {
+	const char *rest, *name = p->x.name ? p->x.name : p->name;
+	int n = labelnum(name, &rest);
+
+	if (n >= 0 && (p->generated || p->scope == LABELS
+	|| (p->scope >= LOCAL && p->sclass == STATIC))) {
+		struct hent *q = hlookup(n, 'L', 0);
+		if (q == NULL) {
+			q = hlookup(n, 'L', 1);
+			q->n = nlabels;
+			if (nlabels >= maxlabels) {
+				int *v = newarray(maxlabels = 2*nlabels + 16, sizeof *v, FUNC);
+				if (nlabels > 0)
+					memcpy(v, labelv, nlabels*sizeof *v);
+				labelv = v;
+			}
+			labelv[nlabels++] = n;
+		}
+		hint(q->n);
+		hstr(rest);
+	} else {
+		if (n >= 0)
+			hlookup(n, 'F', 1);
+		hstr(name);
+	}
+}
+
+static void htype(Type ty) {
+	for ( ; ty; ty = ty->type) {
+		hint(ty->op);
+		hint(ty->size);
+		hint(ty->align);
+		if (isfunc(ty)) {
+			hint(ty->u.f.oldstyle);
+			if (ty->u.f.proto) {
+				int i;
+				for (i = 0; ty->u.f.proto[i]; i++)
+					htype(ty->u.f.proto[i]);
+			}
+		} else if (ty->u.sym)
+			hstr(ty->u.sym->name);
+	}
+	hint(-1);
+}
+
+static void hsym(Symbol p) {
+	struct hent *q;
+
+	if (p == NULL) {
+		hint(0);
+		return;
+	}
+	if ((q = hlookup((unsigned long)p, 'S', 0)) != NULL) {
+		hint(1);
+		hint(q->n);
+		return;
+	}
+	hlookup((unsigned long)p, 'S', 1)->n = nsyms++;
+	hint(2);
+	hint(p->scope);
+	hint(p->sclass);
+	hint(p->structarg | p->addressed<<1 | p->computed<<2
+		| p->temporary<<3 | p->generated<<4 | p->defined<<5);
+	htype(p->type);
+	if (p->scope >= PARAM && p->sclass != STATIC && p->sclass != EXTERN)
+		hbytes(&p->ref, sizeof p->ref);
+	else
+		hname(p);
+}
+
+static void hnode(Node p) {
+	struct hent *q;
+
+	if (p == NULL) {
+		hint(0);
+		return;
+	}
+	if ((q = hlookup((unsigned long)p, 'N', 0)) != NULL) {
+		hint(1);
+		hint(q->n);
+		return;
+	}
+	hlookup((unsigned long)p, 'N', 1)->n = nnodes++;
+	hint(2);
+	hint(p->op);
+	hint(p->count);
+	hsym(p->syms[0]);
+	hsym(p->syms[1]);
+	hsym(p->syms[2]);
+	hnode(p->kids[0]);
+	hnode(p->kids[1]);
+}
+
+/* hashfunc - hash f, its parameters and its Code list into h0, h1 */
+static void hashfunc(Symbol f, Symbol caller[], Symbol callee[], int ncalls) {
+	Code cp;
+	Node p;
+	int i;
+
+	h0 = 2166136261UL;
+	h1 = 1;
+	htab = newarray(256, sizeof *htab, FUNC);
+	for (i = 0; i < 256; i++)
+		htab[i] = NULL;
+	nsyms = nnodes = nlabels = maxlabels = 0;
+	labelv = NULL;
+	hstr(options);
+	hstr(f->name);
+	hsym(f);
+	hint(ncalls);
+	for (i = 0; caller[i]; i++) {
+		hsym(caller[i]);
+		hsym(callee[i]);
+	}
+	hint(-1);
+	for (cp = codehead.next; cp; cp = cp->next) {
+		hint(cp->kind);
+		switch (cp->kind) {
+		case Blockbeg:
+			hint(cp->u.block.level);
+			for (i = 0; cp->u.block.locals[i]; i++)
+				hsym(cp->u.block.locals[i]);
+			hint(-1);
+			break;
+		case Local:
+			hsym(cp->u.var);
+			break;
+		case Address:
+			hsym(cp->u.addr.sym);
+			hsym(cp->u.addr.base);
+			hint(cp->u.addr.offset);
+			break;
+		case Gen: case Jump: case Label:
+			for (p = cp->u.forest; p; p = p->link)
+				hnode(p);
+			hint(-1);
+			break;
+		case Switch:
+			hsym(cp->u.swtch.sym);
+			hsym(cp->u.swtch.table);
+			hsym(cp->u.swtch.deflab);
+			hint(cp->u.swtch.size);
+			for (i = 0; i < cp->u.swtch.size; i++) {
+				hint(cp->u.swtch.values[i]);
+				hsym(cp->u.swtch.labels[i]);
+			}
+			break;
+		case Blockend: case Defpoint: case Start:
+			break;
+		}
+	}
+	clash = 0;
+	for (i = 0; i < nlabels; i++)
+		if (hlookup(labelv[i], 'F', 0))
+			clash = 1;
+}
+
+static char *entryname(void) {
+	return stringf("%s/%X-%X.s", fcachedir, h0, h1);
+}
+
+/*
+ * fcachebegin - copy the cached text of f to the output and set
+ * state[0..n-1] to the values saved with it, or start saving the
+ * text of f
+ */
+int fcachebegin(Symbol f, Symbol caller[], Symbol callee[], int ncalls, int state[], int n) {
+	FILE *fp;
+	char *text, *s;
+	long size;
+	int i, k;
+
+	capturing = 0;
+	if (fcachedir == NULL || errcnt > 0)
+		return 0;
+	hashfunc(f, caller, callee, ncalls);
+	if ((fp = fopen(entryname(), "rb")) != NULL) {
+		if (fscanf(fp, "; fcache %d", &k) == 1 && k == n) {
+			for (i = 0; i < n; i++)
+				if (fscanf(fp, "%d", &state[i]) != 1)
+					break;
+			if (i == n && fscanf(fp, "%d", &k) == 1 && k == nlabels
+			&& getc(fp) == '\n') {
+				long here = ftell(fp);
+				fseek(fp, 0, SEEK_END);
+				size = ftell(fp) - here;
+				fseek(fp, here, SEEK_SET);
+				text = allocate(size + 1, FUNC);
+				if (fread(text, 1, size, fp) == (size_t)size) {
+					text[size] = 0;
+					fclose(fp);
+					for (s = text; *s; s++)
+						if (*s == RELOC) {
+							*s = 0;
+							k = strtol(s + 1, &s, 10);
+							print("%s_L%d", text, k >= 0 && k < nlabels ? labelv[k] : 0);
+							text = s + 1;
+						}
+					print("%s", text);
+					return 1;
+				}
+			}
+		}
+		fclose(fp);
+	}
+	if (clash)
+		return 0;
+	fflush(stdout);
+	if ((start = ftell(stdout)) < 0)
+		return 0;
+	capturing = 1;
+	return 0;
+}
+
+/* fcacheend - save the text emitted since fcachebegin with state[0..n-1] */
+void fcacheend(int state[], int n) {
+	FILE *fp, *out;
+	char *text, *s, *tmp;
+	long size;
+	int i, k;
+	const char *rest;
+
+	if (!capturing || errcnt > 0)
+		return;
+	capturing = 0;
+	fflush(stdout);
+	if ((size = ftell(stdout) - start) < 0
+	|| (fp = fopen(outname, "rb")) == NULL)
+		return;
+	text = allocate(size + 1, FUNC);
+	if (fseek(fp, start, SEEK_SET) != 0
+	|| fread(text, 1, size, fp) != (size_t)size) {
+		fclose(fp);
+		return;
+	}
+	fclose(fp);
+	text[size] = 0;
+	tmp = stringf("%s/%X-%X.tmp", fcachedir, h0, h1);
+	if ((out = fopen(tmp, "wb")) == NULL)
+		return;
+	fprintf(out, "; fcache %d", n);
+	for (i = 0; i < n; i++)
+		fprintf(out, " %d", state[i]);
+	fprintf(out, " %d\n", nlabels);
+	for (s = text; *s; s++)
+		if (s[0] == '_' && (s == text || (!isalnum(s[-1]) && s[-1] != '_'))
+		&& (k = labelnum(s, &rest)) >= 0 && hlookup(k, 'L', 0)) {
+			fprintf(out, "%c%d%c", RELOC, hlookup(k, 'L', 0)->n, RELOC);
+			s = (char *)rest - 1;
+		} else
+			putc(*s, out);
+	if (ferror(out) | fclose(out)
+	|| (rename(tmp, entryname()) != 0 && (remove(entryname()), rename(tmp, entryname())) != 0))
+		remove(tmp);
+}
@@ -1,9 +1,22 @@
 #include "c.h"
+#include <ctype.h>
 
 static char rcsid[] = "$Id$";
 
 static int curseg;		/* current segment */
 
+/*
+ * Arrays of integers are often long tables of plain constants, so
+ * initarray and initchar take an element that is just an integer
+ * constant, optionally negated, without building and folding a tree,
+ * collect the values in a buffer, and emit runs of ZRUN or more zero
+ * bytes with space.
+ */
+#define ZRUN 8
+
+static Value ibuf[256];		/* pending plain values of initarray */
+static int nibuf;
+
 /* defpointer - initialize a pointer to p or to 0 if p==0 */
 void defpointer(Symbol p) {
 	if (p) {
@@ -75,29 +88,150 @@ static Tree initvalue(Type ty) {
 	return e;
 }
 
+/* plainnum - is the text at s a decimal, octal or hex integer followed by , or }? */
+static int plainnum(unsigned char *s) {
+	while (*s == ' ' || *s == '\t')
+		s++;
+	if (*s < '0' || *s > '9')
+		return 0;
+	if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+		for (s += 2; isxdigit(*s); s++)
+			;
+	} else
+		while (*s >= '0' && *s <= '9')
+			s++;
+	while (*s == 'u' || *s == 'U' || *s == 'l' || *s == 'L')
+		s++;
+	while (*s == ' ' || *s == '\t')
+		s++;
+	return *s == ',' || *s == '}';
+}
+
+/*
+ * plainint - if the next initializer for integer type ty is a plain
+ * constant, ICON or -ICON followed by , or }, consume it and set *v
+ */
+static int plainint(Type ty, Value *v) {
+	Tree e;
+	int neg = 0, c;
+
+	if (ty->op != INT && ty->op != UNSIGNED)
+		return 0;
+	if (t == '-' && plainnum(cp)) {
+		t = gettok();
+		neg = 1;
+	} else if (t != ICON || ((c = getchr()) != ',' && c != '}'))
+		return 0;
+	assert(t == ICON);
+	if (tsym->type->op == INT) {
+		long x = neg ? -tsym->u.c.v.i : tsym->u.c.v.i;
+		if (ty->op == INT && x >= ty->u.sym->u.limits.min.i && x <= ty->u.sym->u.limits.max.i) {
+			v->i = x;
+			t = gettok();
+			return 1;
+		}
+		if (ty->op == UNSIGNED && x >= 0 && (unsigned long)x <= ty->u.sym->u.limits.max.u) {
+			v->u = x;
+			t = gettok();
+			return 1;
+		}
+	} else if (!neg && ty->op == UNSIGNED && tsym->u.c.v.u <= ty->u.sym->u.limits.max.u) {
+		v->u = tsym->u.c.v.u;
+		t = gettok();
+		return 1;
+	}
+	/* out of range: fold it as unary and initvalue do, with their warnings */
+	e = tree(mkop(CNST,tsym->type), tsym->type, NULL, NULL);
+	e->u.v = tsym->u.c.v;
+	needconst++;
+	if (neg) {
+		Type pty = promote(e->type);
+		e = cast(e, pty);
+		if (isunsigned(pty)) {
+			warning("unsigned operand of unary -\n");
+			e = simplify(ADD, pty, simplify(BCOM, pty, e, NULL), cnsttree(pty, 1UL));
+		} else
+			e = simplify(NEG, pty, e, NULL);
+	}
+	e = cast(e, ty);
+	needconst--;
+	*v = e->u.v;
+	t = gettok();
+	return 1;
+}
+
+/* flushints - emit the pending values of type ty */
+static void flushints(Type ty) {
+	int i, j;
+
+	for (i = 0; i < nibuf; i = j) {
+		for (j = i; j < nibuf && ibuf[j].u == 0; j++)
+			;
+		if ((j - i)*ty->size >= ZRUN)
+			(*IR->space)((j - i)*ty->size);
+		else {
+			(*IR->defconst)(ty->op, ty->size, ibuf[i]);
+			j = i + 1;
+		}
+	}
+	nibuf = 0;
+}
+
+/* flushchars - emit n bytes of buf */
+static void flushchars(char *buf, int n) {
+	int i, j, k;
+
+	for (i = 0; i < n; i = j) {
+		for (j = i; j < n && buf[j] == 0; j++)
+			;
+		if (j - i >= ZRUN) {
+			(*IR->space)(j - i);
+			continue;
+		}
+		/* up to the next run of ZRUN zeros */
+		for (j = i, k = 0; j < n && k < ZRUN; j++)
+			k = buf[j] == 0 ? k + 1 : 0;
+		if (k == ZRUN)
+			j -= ZRUN;
+		(*IR->defstring)(j - i, buf + i);
+	}
+}
+
 /* initarray - initialize array of ty of <= len bytes; if len == 0, go to } */
 static int initarray(int len, Type ty, int lev) {
 	int n = 0;
 
 	do {
-		initializer(ty, lev);
+		if (plainint(ty, &ibuf[nibuf])) {
+			if (++nibuf == NELEMS(ibuf))
+				flushints(ty);
+		} else {
+			flushints(ty);
+			initializer(ty, lev);
+		}
 		n += ty->size;
 		if (len > 0 && n >= len || t != ',')
 			break;
 		t = gettok();
 	} while (t != '}');
+	flushints(ty);
 	return n;
 }
 
 /* initchar - initialize array of <= len ty characters; if len == 0, go to } */
 static int initchar(int len, Type ty) {
 	int n = 0;
-	char buf[16], *s = buf;
+	char buf[256], *s = buf;
+	Value v;
 
 	do {
-		*s++ = initvalue(ty)->u.v.i;
-		if (++n%inttype->size == 0) {
-			(*IR->defstring)(inttype->size, buf);
+		if (plainint(ty, &v))
+			*s++ = v.i;
+		else
+			*s++ = initvalue(ty)->u.v.i;
+		n++;
+		if (s == buf + sizeof buf) {
+			flushchars(buf, s - buf);
 			s = buf;
 		}
 		if (len > 0 && n >= len || t != ',')
@@ -105,7 +239,7 @@ static int initchar(int len, Type ty) {
 		t = gettok();
 	} while (t != '}');
 	if (s > buf)
-		(*IR->defstring)(s - buf, buf);
+		flushchars(buf, s - buf);
 	return n;
 }
 
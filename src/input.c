@@ -70,6 +70,7 @@ void input_init(int argc, char *argv[]) {
 	bsize = -1;
 	lineno = 0;
 	file = NULL;
+	pchopen(argc, argv);
 	fillbuf();
 	if (cp >= limit)
 		cp = limit;
@@ -48,6 +48,7 @@ int main(int argc, char *argv[]) {
 		exit(EXIT_FAILURE);
 	}
 	init(argc, argv);
+	pchload();
 	t = gettok();
 	(*IR->progbeg)(argc, argv);
 	for (i = 1; i < argc; i++)
@@ -140,6 +141,10 @@ void main_init(int argc, char *argv[]) {
 			fprint(stderr, "%s %s\n", argv[0], rcsid);
 		else if (strncmp(argv[i], "-s", 2) == 0)
 			density = strtod(&argv[i][2], NULL);
+		else if (strncmp(argv[i], "-pch=", 5) == 0)
+			pchfile = &argv[i][5];
+		else if (strncmp(argv[i], "-fcache=", 8) == 0)
+			fcachedir = &argv[i][8];
 		else if (strncmp(argv[i], "-errout=", 8) == 0) {
 			FILE *f = fopen(argv[i]+8, "w");
 			if (f == NULL) {
@@ -182,6 +187,8 @@ void main_init(int argc, char *argv[]) {
 		fprint(stderr, "%s: can't write `%s'\n", argv[0], outfile);
 		exit(EXIT_FAILURE);
 	}
+	if (fcachedir)
+		fcacheinit(argc, argv, outfile);
 }
 /* typestab - emit stab entries for p */
 static void typestab(Symbol p, void *cl) {
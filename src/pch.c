@@ -0,0 +1,700 @@
+#include "c.h"
+
+static char rcsid[] = "$Id$";
+
+/*
+ * -pch=file: precompiled header prefix.
+ *
+ * The prefix of the input is everything before the first
+ * declaration that begins a line of the main file, i.e., the
+ * #included headers.  If file describes the same prefix, compiled
+ * with the same options, rcc skips the prefix and reinstalls the
+ * global types, identifiers and constants it declared; otherwise
+ * rcc compiles the prefix and writes file when it reaches the end
+ * of the prefix.  A prefix that defines anything, or any compile
+ * with errors, -g, -x or -n, writes nothing.
+ *
+ * The key leaves out the main file's lines and cpp's #line markers for
+ * it, whose name and line numbers differ from one translation unit to
+ * the next, so units that include the same headers share the file.
+ *
+ * The file holds interned strings, symbols and types; pointers are
+ * written as indices and types are rebuilt bottom-up through
+ * typenode, so builtin and pointer types are shared as usual.
+ */
+
+#define MAGIC "lcc pch 2\n"
+
+char *pchfile;			/* -pch=file, if non-NULL */
+
+static int saving;		/* write pchfile at the checkpoint */
+static char *options;		/* options the prefix was compiled with */
+static unsigned char *buf, *bp, *bufend;	/* pchfile contents */
+static unsigned long prefix;	/* its header bytes, see prefixscan */
+static int labelno;		/* genlabel(0) at the checkpoint */
+static Symbol tbase, cbase;	/* types, constants installed by type_init */
+
+static struct pent {		/* pointer -> index */
+	void *p;
+	int n;
+	struct pent *link;
+} *ptab[1024];
+static char **strv;		/* strings in order of appearance */
+static int nstr, maxstr;
+static Symbol *symv;		/* symbols */
+static int nsym, maxsym;
+static Type *typev;		/* types, kids first */
+static int ntype, maxtype;
+static FILE *out;
+
+static void *grow(void *v, int n, int *max, int size) {
+	if (n >= *max) {
+		void *w = allocate((*max = 2*n + 64)*size, PERM);
+		if (n > 0)
+			memcpy(w, v, n*size);
+		v = w;
+	}
+	return v;
+}
+
+static struct pent *plookup(void *p, int add) {
+	unsigned h = ((unsigned long)p>>3)&(NELEMS(ptab)-1);
+	struct pent *q;
+
+	for (q = ptab[h]; q; q = q->link)
+		if (q->p == p)
+			return q;
+	if (!add)
+		return NULL;
+	NEW0(q, PERM);
+	q->p = p;
+	q->link = ptab[h];
+	ptab[h] = q;
+	return q;
+}
+
+/* markerfile - the file named by the cpp line marker s[0..n-1], or NULL; set *y to its line */
+static char *markerfile(char *s, int n, int *y) {
+	char *end = s + n, *t;
+
+	while (s < end && (*s == ' ' || *s == '\t'))
+		s++;
+	if (s == end || *s++ != '#')
+		return NULL;
+	while (s < end && (*s == ' ' || *s == '\t'))
+		s++;
+	if (end - s >= 4 && strncmp(s, "line", 4) == 0)
+		for (s += 4; s < end && (*s == ' ' || *s == '\t'); )
+			s++;
+	if (s == end || *s < '0' || *s > '9')
+		return NULL;
+	for (*y = 0; s < end && *s >= '0' && *s <= '9'; s++)
+		*y = 10**y + *s - '0';
+	while (s < end && (*s == ' ' || *s == '\t'))
+		s++;
+	if (s == end || *s++ != '"')
+		return NULL;
+	for (t = s; s < end && *s != '"'; s++)
+		;
+	return s < end ? stringn(t, s - t) : NULL;
+}
+
+/*
+ * prefixscan - hash the headers at the start of stdin into h[0..1].  The
+ * first marker names the main file, whose lines must be blank in a prefix
+ * and, like its markers, are left out.  Stop after *len bytes, or, if *len
+ * is 0, at the first line after *nh header bytes that is neither, and set
+ * *len.  Set *nh, *mainp, or NULL, and *resume, the main file's line
+ * number of the line after the prefix.  A prefix can't end inside a header.
+ */
+static int prefixscan(unsigned long *len, unsigned long *nh, unsigned long h[2],
+	char **mainp, int *resume) {
+	char b[512], *f;
+	unsigned long h0 = 2166136261UL, h1 = 1, n = 0, m = 0, start = 0;
+	int c, i, k, y = 1, y1, inmain = 1, blank;
+
+	*mainp = NULL;
+	while (*len == 0 || n < *len) {
+		start = n;
+		for (k = 0; k < (int)sizeof b && (c = getc(stdin)) != EOF; )
+			if ((b[k++] = c) == '\n')
+				break;
+		if (k == 0)
+			break;
+		n += k;
+		f = b[k-1] == '\n' ? markerfile(b, k, &y1) : NULL;
+		if (f && *mainp == NULL)
+			*mainp = f;
+		if (f && f == *mainp) {
+			inmain = 1;
+			y = y1;
+			continue;
+		}
+		if (*len == 0 && m == *nh && f)
+			break;
+		if (*len == 0 && m == *nh && !inmain)
+			return 0;
+		if (f || !inmain) {
+			inmain = 0;
+			for (;;) {
+				for (i = 0; i < k; i++) {
+					h0 = ((h0^(unsigned char)b[i])*16777619UL)&0xffffffffUL;
+					h1 = (h1*31 + (unsigned char)b[i] + (h1>>27))&0xffffffffUL;
+				}
+				m += k;
+				if (b[k-1] == '\n')
+					break;
+				for (k = 0; k < (int)sizeof b && (c = getc(stdin)) != EOF; )
+					if ((b[k++] = c) == '\n')
+						break;
+				if (k == 0)
+					break;
+				n += k;
+			}
+			if (*len == 0 && m > *nh)
+				return 0;
+			continue;
+		}
+		for (blank = 1; ; ) {
+			for (i = 0; i < k; i++)
+				if (b[i] != ' ' && b[i] != '\t' && b[i] != '\n'
+				&& b[i] != '\r' && b[i] != '\f')
+					blank = 0;
+			if (b[k-1] == '\n')
+				break;
+			for (k = 0; k < (int)sizeof b && (c = getc(stdin)) != EOF; )
+				if ((b[k++] = c) == '\n')
+					break;
+			if (k == 0)
+				break;
+			n += k;
+		}
+		if (!blank && *len == 0 && m == *nh)
+			break;
+		if (!blank)
+			return 0;
+		y++;
+	}
+	if (*len == 0) {
+		if (m != *nh)
+			return 0;
+		*len = start;
+	} else if (n != *len)
+		return 0;
+	*nh = m;
+	h[0] = h0;
+	h[1] = h1;
+	*resume = y;
+	return 1;
+}
+
+static void putn(unsigned long n) {
+	for ( ; n >= 0x80; n >>= 7)
+		putc((int)(n&0x7f)|0x80, out);
+	putc((int)n, out);
+}
+
+static void puti(long n) {
+	putn(n < 0 ? ((unsigned long)~n<<1)|1 : (unsigned long)n<<1);
+}
+
+static void putbytes(const void *p, int n) {
+	fwrite(p, 1, n, out);
+}
+
+static void putstr(const char *s) {
+	struct pent *q;
+
+	if (s == NULL)
+		putn(0);
+	else if ((q = plookup((void *)s, 0)) != NULL)
+		putn(q->n + 2);
+	else {
+		q = plookup((void *)s, 1);
+		q->n = nstr++;
+		putn(1);
+		putn(strlen(s));
+		putbytes(s, strlen(s));
+	}
+}
+
+static void putsym(Symbol p) {
+	if (p == NULL)
+		putn(0);
+	else if (plookup(p, 0)->n < 0) {
+		putn(1);
+		putstr(p->name);
+	} else
+		putn(plookup(p, 0)->n + 2);
+}
+
+static void puttype(Type ty) {
+	putn(ty ? plookup(ty, 0)->n + 1 : 0);
+}
+
+static void corrupt(void) {
+	error("corrupt precompiled header `%s'\n", pchfile);
+	exit(EXIT_FAILURE);
+}
+
+static unsigned long getn(void) {
+	unsigned long n = 0;
+	int shift = 0;
+
+	do {
+		if (bp >= bufend)
+			corrupt();
+		n |= (unsigned long)(*bp&0x7f)<<shift;
+		shift += 7;
+	} while (*bp++&0x80);
+	return n;
+}
+
+static long geti(void) {
+	unsigned long n = getn();
+
+	return n&1 ? ~(long)(n>>1) : (long)(n>>1);
+}
+
+static void getbytes(void *p, int n) {
+	if (bufend - bp < n)
+		corrupt();
+	memcpy(p, bp, n);
+	bp += n;
+}
+
+static char *getstr(void) {
+	unsigned long n = getn();
+
+	if (n == 0)
+		return NULL;
+	if (n == 1) {
+		n = getn();
+		if ((unsigned long)(bufend - bp) < n)
+			corrupt();
+		strv = grow(strv, nstr, &maxstr, sizeof *strv);
+		strv[nstr] = stringn((char *)bp, n);
+		bp += n;
+		return strv[nstr++];
+	}
+	if (n - 2 >= (unsigned long)nstr)
+		corrupt();
+	return strv[n-2];
+}
+
+static Symbol getsym(void) {
+	unsigned long n = getn();
+	Symbol p;
+
+	if (n == 0)
+		return NULL;
+	if (n == 1) {
+		char *name = getstr();
+		if ((p = lookup(name, types)) == NULL) {
+			error("precompiled header `%s' refers to unknown type `%s'\n", pchfile, name);
+			exit(EXIT_FAILURE);
+		}
+		return p;
+	}
+	if (n - 2 >= (unsigned long)nsym)
+		corrupt();
+	return symv[n-2];
+}
+
+static Type gettype(void) {
+	unsigned long n = getn();
+
+	if (n == 0)
+		return NULL;
+	if (n - 1 >= (unsigned long)ntype)
+		corrupt();
+	return typev[n-1];
+}
+
+#define cacheopt(s) (strncmp(s, "-pch=", 5) == 0 || strncmp(s, "-fcache=", 8) == 0)
+
+/* optionstring - the options that can change what rcc emits, one per line */
+char *optionstring(int argc, char *argv[]) {
+	int i, n = 0;
+	char *s;
+
+	for (i = 1; i < argc; i++)
+		if (*argv[i] == '-' && !cacheopt(argv[i]))
+			n += strlen(argv[i]) + 1;
+	s = allocate(n + 1, PERM);
+	for (n = 0, i = 1; i < argc; i++)
+		if (*argv[i] == '-' && !cacheopt(argv[i])) {
+			strcpy(s + n, argv[i]);
+			n += strlen(argv[i]);
+			s[n++] = '\n';
+		}
+	s[n] = 0;
+	return string(s);
+}
+
+/* pchopen - skip the prefix of stdin if pchfile describes it */
+int pchopen(int argc, char *argv[]) {
+	FILE *f;
+	long n;
+	unsigned long h[2];
+	char *mainp;
+	int resume;
+
+	if (pchfile == NULL)
+		return 0;
+	saving = 1;
+	options = optionstring(argc, argv);
+	if (ftell(stdin) != 0 || (f = fopen(pchfile, "rb")) == NULL)
+		return 0;
+	if (fseek(f, 0, SEEK_END) != 0 || (n = ftell(f)) <= 0
+	|| fseek(f, 0, SEEK_SET) != 0) {
+		fclose(f);
+		return 0;
+	}
+	buf = allocate(n, PERM);
+	bufend = buf + fread(buf, 1, n, f);
+	fclose(f);
+	bp = buf;
+	if (bufend - bp < (int)strlen(MAGIC)
+	|| strncmp((char *)bp, MAGIC, strlen(MAGIC)) != 0)
+		return 0;
+	bp += strlen(MAGIC);
+	if (getn() != sizeof (Value) || getn() != sizeof (float)
+	|| getstr() != options)
+		return 0;
+	prefix = getn();
+	h[0] = getn();
+	h[1] = getn();
+	{
+		unsigned long g[2], len = 0;
+		if (!prefixscan(&len, &prefix, g, &mainp, &resume)
+		|| g[0] != h[0] || g[1] != h[1]
+		|| fseek(stdin, len, SEEK_SET) != 0) {
+			fseek(stdin, 0, SEEK_SET);
+			return 0;
+		}
+	}
+	labelno = getn();
+	saving = 0;
+	file = firstfile = mainp;
+	lineno = resume - 1;
+	return 1;
+}
+
+/* pchload - reinstall the symbols and types of the skipped prefix */
+void pchload(void) {
+	int i, n;
+
+	tbase = allsymbols(types);
+	cbase = allsymbols(constants);
+	if (pchfile == NULL || saving || bp == NULL)
+		return;
+	nsym = n = getn();
+	symv = newarray(n + 1, sizeof *symv, PERM);
+	for (i = 0; i < n; i++) {
+		int tab = getn();
+		char *name = getstr();
+		int scope = geti();
+		switch (tab) {
+		case 0:  symv[i] = install(name, &types, GLOBAL, PERM); break;
+		case 1:  symv[i] = install(name, &globals, GLOBAL, PERM); break;
+		case 2:  symv[i] = NULL; break;	/* see below */
+		default: NEW0(symv[i], PERM); symv[i]->name = name; break;
+		}
+		if (symv[i])
+			symv[i]->scope = scope;
+	}
+	ntype = n = getn();
+	typev = newarray(n + 1, sizeof *typev, PERM);
+	for (i = 0; i < n; i++) {
+		int op = getn();
+		Type ty = gettype();
+		int size = geti(), align = geti();
+		if (op == FUNCTION) {
+			int style = getn(), k = getn();
+			Type *proto = NULL;
+			if (k > 0) {
+				int j;
+				proto = newarray(k, sizeof *proto, PERM);
+				for (j = 0; j < k - 1; j++)
+					proto[j] = gettype();
+				proto[j] = NULL;
+			}
+			ty = typenode(FUNCTION, ty, size, align, NULL);
+			ty->u.f.proto = proto;
+			ty->u.f.oldstyle = style;
+		} else
+			ty = typenode(op, ty, size, align, getsym());
+		typev[i] = ty;
+	}
+	for (i = 0; i < nsym; i++) {
+		struct symbol s;
+		Symbol p;
+		int flags, kind;
+
+		memset(&s, 0, sizeof s);
+		s.src.file = getstr();
+		s.src.x = geti();
+		s.src.y = geti();
+		s.sclass = geti();
+		flags = getn();
+		getbytes(&s.ref, sizeof s.ref);
+		s.type = gettype();
+		s.x.name = getstr();
+		if ((p = symv[i]) == NULL) {
+			Value v;
+			if (getn() != 4)
+				corrupt();
+			getbytes(&v, sizeof v);
+			p = symv[i] = constant(s.type, v);
+		}
+		p->src = s.src;
+		p->sclass = s.sclass;
+		p->structarg = flags&1;
+		p->addressed = (flags>>1)&1;
+		p->computed = (flags>>2)&1;
+		p->temporary = (flags>>3)&1;
+		p->generated = (flags>>4)&1;
+		p->defined = (flags>>5)&1;
+		p->ref = s.ref;
+		p->type = s.type;
+		p->x.name = s.x.name;
+		if (p->scope == CONSTANTS)
+			continue;
+		switch (kind = getn()) {
+		case 0:
+			break;
+		case 1: {
+			Field *q = &p->u.s.flist;
+			p->u.s.cfields = getn();
+			p->u.s.vfields = getn();
+			for (n = getn(); n > 0; n--) {
+				NEW0(*q, PERM);
+				(*q)->name = getstr();
+				(*q)->type = gettype();
+				(*q)->offset = geti();
+				(*q)->bitsize = geti();
+				(*q)->lsb = geti();
+				q = &(*q)->link;
+			}
+			break;
+			}
+		case 2:
+			if ((n = getn()) > 0) {
+				int j;
+				p->u.idlist = newarray(n, sizeof *p->u.idlist, PERM);
+				for (j = 0; j < n - 1; j++)
+					p->u.idlist[j] = getsym();
+				p->u.idlist[j] = NULL;
+			}
+			break;
+		case 3:
+			p->u.value = geti();
+			break;
+		default:
+			corrupt();
+		}
+	}
+	if (labelno > genlabel(0))
+		genlabel(labelno - genlabel(0));
+}
+
+static void addsym(Symbol p) {
+	struct pent *q;
+
+	if (p == NULL || plookup(p, 0))
+		return;
+	q = plookup(p, 1);
+	q->n = nsym;
+	symv = grow(symv, nsym, &maxsym, sizeof *symv);
+	symv[nsym++] = p;
+}
+
+static void addtype(Type ty) {
+	struct pent *q;
+
+	if (ty == NULL || plookup(ty, 0))
+		return;
+	addtype(ty->type);
+	if (ty->op == FUNCTION) {
+		if (ty->u.f.proto) {
+			int i;
+			for (i = 0; ty->u.f.proto[i]; i++)
+				addtype(ty->u.f.proto[i]);
+		}
+	} else
+		addsym(ty->u.sym);
+	q = plookup(ty, 1);
+	q->n = ntype;
+	typev = grow(typev, ntype, &maxtype, sizeof *typev);
+	typev[ntype++] = ty;
+}
+
+/* tablesyms - add the symbols of tp newer than base, oldest first */
+static int tablesyms(Table tp, Symbol base) {
+	Symbol p;
+	int i, n = nsym;
+
+	for (p = allsymbols(tp); p && p != base; p = p->up)
+		addsym(p);
+	for (i = n; i < n + (nsym - n)/2; i++) {
+		Symbol t = symv[i];
+		symv[i] = symv[nsym - 1 - (i - n)];
+		symv[nsym - 1 - (i - n)] = t;
+	}
+	for (i = n; i < nsym; i++)
+		plookup(symv[i], 0)->n = i;
+	return nsym - n;
+}
+
+/* istag - is p the tag of a struct, union or enum */
+static int istag(Symbol p) {
+	return p->type && p->type->u.sym == p
+	    && (p->type->op == STRUCT || p->type->op == UNION || p->type->op == ENUM);
+}
+
+/* pchcheckpoint - write pchfile at the end of the prefix */
+void pchcheckpoint(void) {
+	static int done;
+	int i, ntab[3], resume;
+	long offset;
+	unsigned long h[2], len;
+	char *s, *tmp, *mainp;
+	Symbol p;
+
+	if (!saving || done || src.file != firstfile || firstfile == NULL)
+		return;
+	done = 1;
+	if (errcnt > 0 || glevel || xref || YYnull || level != GLOBAL
+	|| allsymbols(externals) || lineno != src.y || file != src.file)
+		return;
+	for (s = line; s < line + src.x; s++)
+		if (*s != ' ' && *s != '\t')
+			return;
+	for (p = allsymbols(identifiers); p; p = p->up)
+		if (p->defined || p->scope != GLOBAL)
+			return;
+	for (p = allsymbols(constants); p && p != cbase; p = p->up)
+		if (p->u.c.loc || isarray(p->type) || p->type->op == FUNCTION)
+			return;
+	if ((offset = ftell(stdin)) < 0)
+		return;
+	len = offset - (limit - (unsigned char *)line);
+	if (len == 0 || fseek(stdin, 0, SEEK_SET) != 0)
+		return;
+	i = prefixscan(&len, &prefix, h, &mainp, &resume);
+	if (fseek(stdin, offset, SEEK_SET) != 0 || !i || prefix == 0
+	|| mainp != firstfile || resume != lineno)
+		return;
+	for (p = tbase; p; p = p->up)
+		plookup(p, 1)->n = -1;
+	ntab[0] = tablesyms(types, tbase);
+	ntab[1] = tablesyms(identifiers, NULL);
+	ntab[2] = tablesyms(constants, cbase);
+	for (i = 0; i < nsym; i++) {
+		Symbol p = symv[i];
+		addtype(p->type);
+		if (p->scope != CONSTANTS && istag(p)) {
+			if (p->type->op == ENUM) {
+				int j;
+				for (j = 0; p->u.idlist && p->u.idlist[j]; j++)
+					addsym(p->u.idlist[j]);
+			} else {
+				Field f;
+				for (f = p->u.s.flist; f; f = f->link)
+					addtype(f->type);
+			}
+		}
+	}
+	tmp = stringf("%s.tmp", pchfile);
+	if ((out = fopen(tmp, "wb")) == NULL) {
+		warning("can't write precompiled header `%s'\n", pchfile);
+		return;
+	}
+	nstr = 0;
+	putbytes(MAGIC, strlen(MAGIC));
+	putn(sizeof (Value));
+	putn(sizeof (float));
+	putstr(options);
+	putn(prefix);
+	putn(h[0]);
+	putn(h[1]);
+	putn(genlabel(0));
+	putn(nsym);
+	for (i = 0; i < nsym; i++) {
+		int tab = i < ntab[0] ? 0 : i < ntab[0] + ntab[1] ? 1
+			: i < ntab[0] + ntab[1] + ntab[2] ? 2 : 3;
+		putn(tab);
+		putstr(symv[i]->name);
+		puti(symv[i]->scope);
+	}
+	putn(ntype);
+	for (i = 0; i < ntype; i++) {
+		Type ty = typev[i];
+		putn(ty->op);
+		puttype(ty->type);
+		puti(ty->size);
+		puti(ty->align);
+		if (ty->op == FUNCTION) {
+			int j = 0;
+			putn(ty->u.f.oldstyle);
+			if (ty->u.f.proto)
+				while (ty->u.f.proto[j++])
+					;
+			putn(j);
+			for (j = 0; ty->u.f.proto && ty->u.f.proto[j]; j++)
+				puttype(ty->u.f.proto[j]);
+		} else
+			putsym(ty->u.sym);
+	}
+	for (i = 0; i < nsym; i++) {
+		Symbol p = symv[i];
+		putstr(p->src.file);
+		puti(p->src.x);
+		puti(p->src.y);
+		puti(p->sclass);
+		putn(p->structarg | p->addressed<<1 | p->computed<<2
+			| p->temporary<<3 | p->generated<<4 | p->defined<<5);
+		putbytes(&p->ref, sizeof p->ref);
+		puttype(p->type);
+		putstr(p->x.name);
+		if (p->scope == CONSTANTS) {
+			putn(4);
+			putbytes(&p->u.c.v, sizeof p->u.c.v);
+		} else if (istag(p) && p->type->op == ENUM) {
+			int j = 0;
+			putn(2);
+			if (p->u.idlist)
+				while (p->u.idlist[j++])
+					;
+			putn(j);
+			for (j = 0; p->u.idlist && p->u.idlist[j]; j++)
+				putsym(p->u.idlist[j]);
+		} else if (istag(p)) {
+			Field f;
+			int j = 0;
+			putn(1);
+			putn(p->u.s.cfields);
+			putn(p->u.s.vfields);
+			for (f = p->u.s.flist; f; f = f->link)
+				j++;
+			putn(j);
+			for (f = p->u.s.flist; f; f = f->link) {
+				putstr(f->name);
+				puttype(f->type);
+				puti(f->offset);
+				puti(f->bitsize);
+				puti(f->lsb);
+			}
+		} else if (p->sclass == ENUM) {
+			putn(3);
+			puti(p->u.value);
+		} else
+			putn(0);
+	}
+	if (ferror(out) | fclose(out)
+	|| (rename(tmp, pchfile) != 0 && (remove(pchfile), rename(tmp, pchfile)) != 0)) {
+		remove(tmp);
+		warning("can't write precompiled header `%s'\n", pchfile);
+	}
+}
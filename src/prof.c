@@ -24,7 +24,8 @@ struct map {		/* source code map; 200 coordinates/map */
 int npoints;		/* # of execution points if -b specified */
 int ncalled = -1;	/* #times prof.out says current function was called */
 static Symbol YYlink;	/* symbol for file's struct _bbdata */
-static Symbol YYcounts;	/* symbol for _YYcounts if -b specified */
+Symbol YYcounts;		/* symbol for _YYcounts if -b specified */
+static Type counttype;	/* type of _YYcounts' elements */
 static List maplist;	/* list of struct map *'s */
 static List filelist;	/* list of file names */
 static Symbol funclist;	/* list of struct func *'s */
@@ -182,10 +183,12 @@ static void bbvars(Symbol yylink, void *ignore, void *ignore2) {
 	if (YYcounts) {
 		if (n <= 0)
 			n = 1;
-		YYcounts->type = array(inttype, n, 0);
+		YYcounts->type = array(counttype, n, 0);
 		defglobal(YYcounts, BSS);
 		(*IR->space)(YYcounts->type->size);
 	}
+	if (unsignedtype->size < 4)
+		return;	/* no coordinates or hosted runtime; see profInit */
 	files = genident(STATIC, array(charptype, 1, 0), GLOBAL);
 	defglobal(files, LIT);
 	for (p = ltov(&filelist, PERM); *p; p++)
@@ -217,16 +220,27 @@ void profInit(char *arg) {
 			ncalled = 0;
 	} else if ((strcmp(arg, "-b") == 0
 	         || strcmp(arg, "-C") == 0) && YYlink == 0) {
+		/*
+		 * Coordinates need 32 bits, and lib/bbexit.c needs a hosted
+		 * library, so a target with 16-bit ints gets only 32-bit
+		 * point counters, which the back end lays out and a host
+		 * tool reads from memory (e.g. etc/nxprof.c).
+		 */
+		int hosted = unsignedtype->size >= 4;
 		YYlink = genident(STATIC, array(voidptype, 0, 0), GLOBAL);
-		attach((Apply)bbentry, YYlink, &events.entry);
-		attach((Apply)bbexit,  YYlink, &events.returns);
-		attach((Apply)bbfunc,  YYlink, &events.exit);
+		if (hosted) {
+			attach((Apply)bbentry, YYlink, &events.entry);
+			attach((Apply)bbexit,  YYlink, &events.returns);
+			attach((Apply)bbfunc,  YYlink, &events.exit);
+		}
 		attach((Apply)bbvars,  YYlink, &events.end);
 		if (strcmp(arg, "-b") == 0) {
-			YYcounts = genident(STATIC, array(inttype, 0, 0), GLOBAL);
+			counttype = hosted ? inttype : unsignedlong;
+			YYcounts = genident(STATIC, array(counttype, 0, 0), GLOBAL);
 			maplist = append(allocate(sizeof (struct map), PERM), maplist);
 			((struct map *)maplist->x)->size = 0;
-			attach((Apply)bbcall, YYcounts, &events.calls);
+			if (hosted)
+				attach((Apply)bbcall, YYcounts, &events.calls);
 			attach((Apply)bbincr, YYcounts, &events.points);
 		}
 	}
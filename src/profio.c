@@ -10,6 +10,11 @@ prof.out format:
 #points
     file# x y count
     ... (#points-1 times)
+
+A compact prof.out, as written by bprint -C, begins with the four bytes
+"PROF" and holds the same records, with each number as four bytes,
+least significant first, and each name terminated by a zero byte.
+process reads either form; a compact one is read with a single fread.
 */
 #include "c.h"
 
@@ -42,15 +47,50 @@ struct file {			/* per-file prof.out data: */
 	} *funcs;			/* list of functions */
 } *filelist;
 FILE *fp;
+static unsigned char *bin, *binlimit;	/* compact prof.out data in bin[0..binlimit-1] */
+
+#define HASHSIZE 4096
+
+static struct entry {		/* hash table entry: */
+	struct entry *link;		/* link to next entry in bucket */
+	void *key;			/* owning file or callee, or 0 for files */
+	char *name, *file;		/* function or caller, call site file */
+	int x, y;			/* point or call site */
+	void *p;			/* file, function or caller */
+	int i;				/* index of point in counts[] */
+} *buckets[HASHSIZE];
+
+/* findentry - return the entry for (key,name,file,x,y), installing it if new, or 0 */
+static struct entry *findentry(void *key, char *name, char *file, int x, int y, int new) {
+	unsigned h = ((unsigned long)key>>3) + ((unsigned long)name>>3)
+		+ ((unsigned long)file>>3) + x + 31*y;
+	struct entry *e;
+
+	for (e = buckets[h&(HASHSIZE-1)]; e; e = e->link)
+		if (e->key == key && e->name == name && e->file == file
+		&& e->x == x && e->y == y)
+			return e;
+	if (new) {
+		NEW(e, PERM);
+		e->key = key;
+		e->name = name;
+		e->file = file;
+		e->x = x;
+		e->y = y;
+		e->p = 0;
+		e->i = -1;
+		e->link = buckets[h&(HASHSIZE-1)];
+		buckets[h&(HASHSIZE-1)] = e;
+	}
+	return e;
+}
 
 /* acaller - add caller and site (file,x,y) to callee's callers list */
 static void acaller(char *caller, char *file, int x, int y, int count, struct func *callee) {
-	struct caller *q;
+	struct entry *e = findentry(callee, caller, file, x, y, 1);
+	struct caller *q = e->p;
 
 	assert(callee);
-	for (q = callee->callers; q && (caller != q->name
-		|| file != q->file || x != q->x || y != q->y); q = q->link)
-		;
 	if (!q) {
 		struct caller **r;
 		NEW(q, PERM);
@@ -64,6 +104,7 @@ static void acaller(char *caller, char *file, int x, int y, int count, struct fu
 			;
 		q->link = *r;
 		*r = q;
+		e->p = q;
 	}
 	q->count += count;
 }
@@ -79,23 +120,20 @@ static int compare(const void *x, const void *y) {
 
 /* findfile - return file name's file list entry, or 0 */
 static struct file *findfile(char *name) {
-	struct file *p;
+	struct entry *e = findentry(0, name, 0, 0, 0, 0);
 
-	for (p = filelist; p; p = p->link)
-		if (p->name == name)
-			return p;
-	return 0;
+	return e ? e->p : 0;
 }
 
 /* afunction - add function name and its data to file's function list */
 static struct func *afunction(char *name, char *file, int x, int y, int count) {
 	struct file *p = findfile(file);
+	struct entry *e;
 	struct func *q;
 
 	assert(p);
-	for (q = p->funcs; q && name != q->name; q = q->link)
-		;
-	if (!q) {
+	e = findentry(p, name, 0, 0, 0, 1);
+	if ((q = e->p) == 0) {
 		struct func **r;
 		NEW(q, PERM);
 		q->name = name;
@@ -107,6 +145,7 @@ static struct func *afunction(char *name, char *file, int x, int y, int count) {
 			;
 		q->link = *r;
 		*r = q;
+		e->p = q;
 	}
 	q->count.count += count;
 	return q;
@@ -135,14 +174,15 @@ static void apoint(int i, char *file, int x, int y, int count) {
 			p->counts[j] = z;
 		}
 	}
-	if (p->counts[i].x != x || p->counts[i].y != y)
-		for (i = 0; i < p->count; i++)
-			if (p->counts[i].x == x && p->counts[i].y == y)
-				break;
+	if (i >= p->count || p->counts[i].x != x || p->counts[i].y != y) {
+		struct entry *e = findentry(p, 0, 0, x, y, 0);
+		i = e ? e->i : p->count;
+	}
 	if (i >= p->count)
 		if (i >= p->size)
 			apoint(i, file, x, y, count);
 		else {
+			findentry(p, 0, 0, x, y, 1)->i = i;
 			p->count = i + 1;
 			p->counts[i].x = x;
 			p->counts[i].y = y;
@@ -181,10 +221,9 @@ int findfunc(char *name, char *file) {
 	if (cursor == 0 || cursor->name != file)
 		cursor = findfile(file);
 	if (cursor) {
-		struct func *p;
-		for (p = cursor->funcs; p; p = p->link)
-			if (p->name == name)
-				return p->count.count;
+		struct entry *e = findentry(cursor, name, 0, 0, 0, 0);
+		if (e && e->p)
+			return ((struct func *)e->p)->count.count;
 	}
 	return -1;
 }
@@ -193,6 +232,13 @@ int findfunc(char *name, char *file) {
 static int getd(void) {
 	int c, n = 0;
 
+	if (bin) {
+		if (binlimit - bin < 4 || bin[3] >= 0x80)
+			return -1;
+		n = bin[0] | bin[1]<<8 | bin[2]<<16 | bin[3]<<24;
+		bin += 4;
+		return n;
+	}
 	while ((c = getc(fp)) != EOF && (c == ' ' || c == '\n' || c == '\t'))
 		;
 	if (c >= '0' && c <= '9') {
@@ -209,6 +255,13 @@ static char *getstr(void) {
 	int c;
 	char buf[MAXTOKEN], *s = buf;
 
+	if (bin) {
+		while (bin < binlimit && (c = *bin++) != 0)
+			if (s - buf < (int)sizeof buf - 2)
+				*s++ = c;
+		*s = 0;
+		return s == buf ? (char *)0 : string(buf);
+	}
 	while ((c = getc(fp)) != EOF && c != ' ' && c != '\n' && c != '\t')
 		if (s - buf < (int)sizeof buf - 2)
 			*s++ = c;
@@ -236,6 +289,7 @@ static int gather(void) {
 			new->funcs = 0;
 			new->link = filelist;
 			filelist = new;
+			findentry(0, files[i], 0, 0, 0, 1)->p = new;
 		}
 	}
 	if ((nfuncs = getd()) < 0)
@@ -271,15 +325,38 @@ static int gather(void) {
 int process(char *file) {
 	int more;
 
-	if ((fp = fopen(file, "r")) != NULL) {
+	if ((fp = fopen(file, "rb")) != NULL) {
 		struct file *p;
+		unsigned char *buf = 0;
+		char magic[4];
+		if (fread(magic, 1, 4, fp) == 4 && strncmp(magic, "PROF", 4) == 0) {
+			long n;
+			fseek(fp, 0L, SEEK_END);
+			n = ftell(fp) - 4;
+			fseek(fp, 4L, SEEK_SET);
+			buf = malloc(n > 0 ? n : 1);
+			if (buf == 0 || n < 0 || fread(buf, 1, n, fp) != (size_t)n) {
+				free(buf);
+				fclose(fp);
+				return -1;
+			}
+			bin = buf;
+			binlimit = buf + n;
+		} else
+			rewind(fp);
 		while ((more = gather()) > 0)
 			;
 		fclose(fp);
+		bin = binlimit = 0;
+		free(buf);
 		if (more < 0)
 			return more;
-		for (p = filelist; p; p = p->link)
+		for (p = filelist; p; p = p->link) {
+			int i;
 			qsort(p->counts, p->count, sizeof *p->counts, compare);
+			for (i = 0; i < p->count; i++)
+				findentry(p, 0, 0, p->counts[i].x, p->counts[i].y, 1)->i = i;
+		}
 		return 1;
 	}
 	return 0;
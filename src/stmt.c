@@ -59,12 +59,12 @@ void definept(Coordinate *p) {
 
 	cp->u.point.src = p ? *p : src;
 	cp->u.point.point = npoints;
-	if (ncalled > 0) {
-		int n = findcount(cp->u.point.src.file,
+	cp->u.point.count = -1;
+	if (ncalled >= 0)
+		cp->u.point.count = findcount(cp->u.point.src.file,
 			cp->u.point.src.x, cp->u.point.src.y);
-		if (n > 0)
-			refinc = (float)n/ncalled;
-	}
+	if (ncalled > 0 && cp->u.point.count > 0)
+		refinc = (float)cp->u.point.count/ncalled;
 	if (glevel > 2)	locus(identifiers, &cp->u.point.src);
 	if (events.points && reachable(Gen))
 		{
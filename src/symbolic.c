@@ -6,7 +6,7 @@
 static char rcsid[] = "$Id$";
 
 static Node *tail;
-static int off, maxoff, uid = 0, verbose = 0, html = 0;
+static int off, maxoff, uid = 0, verbose = 0, html = 0, json = 0, forest;
 
 static const char *yyBEGIN(const char *tag) {
 	if (html)
@@ -24,7 +24,7 @@ static void yyEND(const char *tag) {
 #define BEGIN(tag) do { const char *yytag=yyBEGIN(#tag)
 #define END yyEND(yytag); } while (0)
 #define ITEM BEGIN(li)
-#define START BEGIN(LI)
+#define START if (!json) BEGIN(LI)
 #define ANCHOR(attr,code) do { const char *yytag="a"; if (html) { printf("<a " #attr "=\""); code; print("\">"); }
 #define NEWLINE print(html ? "<br>\n" : "\n")
 
@@ -43,7 +43,7 @@ static void emitString(int len, const char *s) {
 		else if (*s == '<' && html)
 			print("&lt;");
 		else if (*s == '>' && html)
-			print("&lt;");
+			print("&gt;");
 		else if (*s == '"' || *s == '\\')
 			print("\\%c", *s);
 		else if (*s >= ' ' && *s < 0177)
@@ -52,6 +52,52 @@ static void emitString(int len, const char *s) {
 			print("\\%d%d%d", (*s>>6)&3, (*s>>3)&7, *s&7);
 }
 
+/*
+ * localf - formatted output to a string that lasts as long as p;
+ * names of locals, temporaries and labels go in the FUNC arena rather
+ * than the string table, so they are freed with their function
+ */
+static char *localf(Symbol p, const char *fmt, ...) {
+	char buf[1024];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprint(NULL, buf, fmt, ap);
+	va_end(ap);
+	if ((p->scope >= PARAM && p->sclass != STATIC && p->sclass != EXTERN)
+	|| p->scope == LABELS || p->temporary)
+		return strcpy(allocate(strlen(buf) + 1, FUNC), buf);
+	return string(buf);
+}
+
+/* opstring - return opname(op), which formats and interns the name on every call */
+static char *opstring(int op) {
+	static struct {
+		int op;
+		char *name;
+	} cache[256];
+	unsigned h = (op^(op>>8))&(NELEMS(cache)-1);
+
+	if (cache[h].name == NULL || cache[h].op != op) {
+		cache[h].op = op;
+		cache[h].name = opname(op);
+	}
+	return cache[h].name;
+}
+
+/* emitJSONString - emit s as a JSON string */
+static void emitJSONString(const char *s) {
+	print("\"");
+	for ( ; *s; s++)
+		if (*s == '"' || *s == '\\')
+			print("\\%c", *s);
+		else if (*s >= ' ' && *s < 0177)
+			print("%c", *s);
+		else
+			print("\\u00%x%x", (*s>>4)&017, *s&017);
+	print("\"");
+}
+
 static void emitSymRef(Symbol p) {
 	(*IR->defsymbol)(p);
 	ANCHOR(href,print("#%s", p->x.name)); BEGIN(code); print("%s", p->name); END; END;
@@ -104,7 +150,7 @@ static void emitSymbol(Symbol p) {
 
 /* address - initialize q for addressing expression p+n */
 static void I(address)(Symbol q, Symbol p, long n) {
-	q->name = stringf("%s%s%D", p->name, n > 0 ? "+" : "", n);
+	q->name = localf(q, "%s%s%D", p->name, n > 0 ? "+" : "", n);
 	(*IR->defsymbol)(q);
 	START; print("address "); emitSymbol(q); END;
 }
@@ -183,11 +229,59 @@ static void I(defstring)(int len, char *s) {
 /* defsymbol - define a symbol: initialize p->x */
 static void I(defsymbol)(Symbol p) {
 	if (p->x.name == NULL)
-		p->x.name = stringd(++uid);
+		p->x.name = localf(p, "%d", ++uid);
+}
+
+/* emitJSON - emit the dags on list p as one JSON object */
+static void emitJSON(Node p) {
+	char *sep = "";
+
+	print("{\"function\":");
+	emitJSONString(cfunc ? cfunc->name : "");
+	print(",\"forest\":%d", ++forest);
+	if (src.file && *src.file) {
+		print(",\"file\":");
+		emitJSONString(src.file);
+	}
+	print(",\"line\":%d,\"nodes\":[", src.y);
+	for (; p; p = p->x.next, sep = ",") {
+		int i;
+		if (p->op == LABEL+V) {
+			print("%s{\"label\":", sep);
+			emitJSONString(p->syms[0]->name);
+			print("}");
+			continue;
+		}
+		print("%s{\"id\":%d,\"op\":\"%s\"", sep, p->x.inst, opstring(p->op));
+		if (p->x.listed)
+			print(",\"root\":1");
+		if (p->count > 1)
+			print(",\"count\":%d", p->count);
+		if (p->kids[0]) {
+			print(",\"kids\":[%d", p->kids[0]->x.inst);
+			if (p->kids[1])
+				print(",%d", p->kids[1]->x.inst);
+			print("]");
+		}
+		if (generic(p->op) != CALL && p->syms[0]) {
+			print(",\"syms\":[");
+			for (i = 0; i < NELEMS(p->syms) && p->syms[i]; i++) {
+				print(i ? "," : "");
+				emitJSONString(p->syms[i]->name);
+			}
+			print("]");
+		}
+		print("}");
+	}
+	print("]}\n");
 }
 
 /* emit - emit the dags on list p */
 static void I(emit)(Node p){
+	if (json) {
+		emitJSON(p);
+		return;
+	}
 	ITEM;
 	if (!html)
 		print(" ");
@@ -202,9 +296,9 @@ static void I(emit)(Node p){
 			int i;
 			if (p->x.listed) {
 				BEGIN(strong); print("%d", p->x.inst); END; print("'");
-				print(" %s", opname(p->op));
+				print(" %s", opstring(p->op));
 			} else
-				print("%d. %s", p->x.inst, opname(p->op));
+				print("%d. %s", p->x.inst, opstring(p->op));
 			if (p->count > 1)
 				print(" count=%d", p->count);
 			for (i = 0; i < NELEMS(p->kids) && p->kids[i]; i++)
@@ -241,7 +335,10 @@ static void I(function)(Symbol f, Symbol caller[], Symbol callee[], int ncalls)
 		caller[i]->x.offset = callee[i]->x.offset = off;
 		off += caller[i]->type->size;
 	}
-	if (!html) {
+	forest = 0;
+	if (json)
+		;
+	else if (!html) {
 		print("function ");
 		emitSymbol(f);
 		print(" ncalls=%d\n", ncalls);
@@ -274,10 +371,10 @@ static void I(function)(Symbol f, Symbol caller[], Symbol callee[], int ncalls)
 	}
 	maxoff = off = 0;
 	gencode(caller, callee);
-	if (html)
+	if (html) {
 		START; print("emitcode"); BEGIN(ul); emitcode(); END; END;
-	else
-		emitcode();
+	} else
+		emitcode();	/* each forest is printed as it is emitted */
 	START; print("maxoff=%d", maxoff); END;
 #undef xx
 }
@@ -337,7 +434,7 @@ static void I(import)(Symbol p) {
 /* local - local variable */
 static void I(local)(Symbol p) {
 	if (p->temporary)
-		p->name = stringf("t%s", p->name);
+		p->name = localf(p, "t%s", p->name);
 	(*IR->defsymbol)(p);
 	off = roundup(off, p->type->align);
 	p->x.offset = off;
@@ -354,6 +451,10 @@ static void I(progbeg)(int argc, char *argv[]) {
 			verbose++;
 		else if (strcmp(argv[i], "-html") == 0)
 			html++;
+		else if (strcmp(argv[i], "-json") == 0)
+			json++;
+	if (json)
+		html = 0;
 	if (html) {
 		print("<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 3.2 Final//EN\">\n");
 		print("<html>");
@@ -410,6 +511,8 @@ static void I(stabblock)(int brace, int lev, Symbol *p) {}
 static void I(stabend)(Coordinate *cp, Symbol p, Coordinate **cpp, Symbol *sp, Symbol *stab) {
 	int i;
 
+	if (json)
+		return;
 	if (p)
 		emitSymRef(p);
 	print("\n");
@@ -426,6 +529,8 @@ static void I(stabinit)(char *file, int argc, char *argv[]) {}
 
 /* stabline - emit line number information for source coordinate *cp */
 static void I(stabline)(Coordinate *cp) {
+	if (json)
+		return;
 	if (cp->file)
 		print("%s:", cp->file);
 	print("%d.%d:\n", cp->y, cp->x);
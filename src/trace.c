@@ -5,6 +5,11 @@ static char rcsid[] = "$Id$";
 static char *fmt, *fp, *fmtend;	/* format string, current & limit pointer */
 static Tree args;		/* printf arguments */
 static Symbol frameno;		/* local holding frame number */
+static Symbol ring;		/* -tring=N buffer, _tracebuf */
+static int ringsize;		/* number of records in ring */
+
+#define RECWORDS 8		/* words per ring record */
+#define RINGMAGIC 0x5452	/* first word of ring */
 
 /* appendstr - append str to the evolving format string, expanding it if necessary */
 static void appendstr(char *str) {
@@ -158,9 +163,131 @@ static void tracereturn(Symbol printer, Symbol f, Tree e) {
 	tracefinis(printer);
 }
 
+/* ringword - return the address of word i of ring */
+static Tree ringword(int i) {
+	return (*optree['+'])(ADD, pointer(idtree(ring)), consttree(i, inttype));
+}
+
+/* ringstore - generate code to store e in word i of the current ring record */
+static void ringstore(int i, Tree e) {
+	Tree p = cast(ringword(4 + i), charptype);
+
+	p = (*optree['+'])(ADD, p, rvalue(ringword(3)));
+	walk(asgntree(ASGN, rvalue(cast(p, ptr(unsignedtype))), cast(e, unsignedtype)), 0, 0);
+}
+
+/* ringvalue - store e in words i... of the current record, append its code, and return the number of words */
+static int ringvalue(Tree e, int i) {
+	Type ty = unqual(e->type);
+	int n;
+
+	if (isenum(ty))
+		ty = ty->type;
+	n = (ty->size + unsignedtype->size - 1)/unsignedtype->size;
+	if ((isint(ty) || isptr(ty)) && n == 1 && i < RECWORDS) {
+		if (isptr(ty))
+			appendstr("p");
+		else if (ty->size == 1)
+			appendstr(ty->op == INT ? "c" : "C");
+		else
+			appendstr(ty->op == INT ? "i" : "u");
+		ringstore(i, e);
+		return 1;
+	}
+	if (generic(e->op) == INDIR && isaddrop(e->kids[0]->op)
+	&& n > 0 && i + n <= RECWORDS) {
+		static char code[] = "w0";
+		Symbol p = e->kids[0]->u.sym;
+		int j;
+		p->addressed = 1;
+		code[1] = '0' + n;
+		appendstr(code);
+		for (j = 0; j < n; j++)
+			ringstore(i + j, rvalue((*optree['+'])(ADD,
+				cast(addrof(idtree(p)), ptr(unsignedtype)), consttree(j, inttype))));
+		return n;
+	}
+	appendstr("?");
+	return 0;
+}
+
+/* ringfinis - complete the current record with its descriptor and frame number, and advance the ring */
+static void ringfinis(void) {
+	Symbol p;
+	int size = RECWORDS*unsignedtype->size;
+
+	*fp = 0;
+	p = mkstr(string(fmt));
+	ringstore(0, pointer(idtree(p->u.c.loc)));
+	ringstore(1, idtree(frameno));
+	walk(asgntree(ASGN, rvalue(ringword(3)),
+		(*optree['&'])(BAND,
+			(*optree['+'])(ADD, rvalue(ringword(3)), consttree(size, unsignedtype)),
+			consttree(ringsize*size - 1, unsignedtype))), 0, 0);
+	fp = fmtend = 0;
+}
+
+/* defring - define ring: magic, number of records, words per record, position, records */
+static void defring(void) {
+	int i, header[4];
+
+	header[0] = RINGMAGIC;
+	header[1] = ringsize;
+	header[2] = RECWORDS;
+	header[3] = 0;
+	defglobal(ring, DATA);
+	for (i = 0; i < NELEMS(header); i++) {
+		Value v;
+		v.u = header[i];
+		(*IR->defconst)(U, unsignedtype->size, v);
+	}
+	(*IR->space)(ringsize*RECWORDS*unsignedtype->size);
+}
+
+/* ringcall - generate code to record entry to f in ring */
+static void ringcall(void *ignore, Symbol f, void *ignore2) {
+	int i, n = 2;
+	Symbol counter = genident(STATIC, inttype, GLOBAL);
+
+	if (!ring->defined && strcmp(f->name, "main") == 0 && f->sclass != STATIC)
+		defring();
+	defglobal(counter, BSS);
+	(*IR->space)(counter->type->size);
+	frameno = genident(AUTO, inttype, level);
+	addlocal(frameno);
+	walk(asgn(frameno, incr(INCR, idtree(counter), consttree(1, inttype))), 0, 0);
+	appendstr("call "); appendstr(f->name);
+	for (i = 0; f->u.f.callee[i]; i++) {
+		appendstr(" "); appendstr(f->u.f.callee[i]->name); appendstr(":");
+		n += ringvalue(idtree(f->u.f.callee[i]), n);
+	}
+	if (variadic(f->type))
+		appendstr(" ...");
+	ringfinis();
+}
+
+/* ringreturn - generate code to record return e from f in ring */
+static void ringreturn(void *ignore, Symbol f, Tree e) {
+	appendstr("return "); appendstr(f->name);
+	if (freturn(f->type) != voidtype && e) {
+		appendstr(" ");
+		ringvalue(e, 2);
+	}
+	ringfinis();
+}
+
 /* traceInit - initialize for tracing */
 void traceInit(char *arg) {
-	if (strncmp(arg, "-t", 2) == 0 && strchr(arg, '=') == NULL) {
+	if (strncmp(arg, "-tring=", 7) == 0) {
+		int n = atoi(&arg[7]);
+		unsigned long max = unsignedtype->size < 4 ? 1UL<<(8*unsignedtype->size - 1) : 1UL<<24;
+		for (ringsize = 1; ringsize < n && 2UL*ringsize*RECWORDS*unsignedtype->size <= max; ringsize <<= 1)
+			;
+		ring = mksymbol(EXTERN, "_tracebuf", array(unsignedtype, 4 + ringsize*RECWORDS, 0));
+		ring->defined = 0;
+		attach((Apply)ringcall,   NULL, &events.entry);
+		attach((Apply)ringreturn, NULL, &events.returns);
+	} else if (strncmp(arg, "-t", 2) == 0 && strchr(arg, '=') == NULL) {
 		Symbol printer = mksymbol(EXTERN, arg[2] ? &arg[2] : "printf",
 			ftype(inttype, ptr(qual(CONST, chartype)), voidtype, NULL));
 		printer->defined = 0;
@@ -86,6 +86,10 @@ static Type type(int op, Type ty, int size, int align, void *sym) {
 	typetable[h] = tn;
 	return &tn->type;
 }
+/* typenode - the type op(ty) of the given size, alignment and symbol */
+Type typenode(int op, Type ty, int size, int align, void *sym) {
+	return type(op, ty, size, align, sym);
+}
 void type_init(int argc, char *argv[]) {
 	static int inited;
 	int i;